@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
@@ -8,20 +9,55 @@
 #include <inttypes.h>
 #include <dirent.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #include <sys/syscall.h>
+    #include <linux/io_uring.h>
+    #define CL_HAS_IO_URING
+#endif
 
 #include "logger.h"
 
 #define REGISTERED_THREAD_NAME_LEN_MAX 256
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define CL_IO_BATCHES_IN_FLIGHT         4
+#define CL_IO_MAX_OPS_PER_BATCH         (2 * MAX_BUFFERED_MESSAGES)
+#define CL_IO_BATCH_DATA_SIZE           (MAX_BUFFERED_MESSAGES * (MAX_MESSAGE_SIZE + CL_RECORD_STAMP_LEN + 1 + CL_INDEX_MAGIC_LEN + sizeof(cl_index_entry)))
+#define CL_IO_URING_ENTRIES             256
+#define CL_IO_DISABLE_WAIT_MS           1000
+#define CL_MAX_OPEN_FILES               64              // least recently used files are closed beyond this (a batch needs at most 2 * MAX_BUFFERED_MESSAGES)
+#define CL_INDEX_BLOCK_BYTES            (64 * 1024)
+#define CL_INDEX_BLOCK_NS               1000000000ull
+#define CL_SHM_RING_SLOTS               4096            // must be a power of 2
+#define CL_RUN_LOCK_NAME                ".lock"         // flock()ed by the process that owns a run directory
+#define CL_SHM_MAGIC                    0x434C53484D303031ull
+#define CL_SHM_READY                    (CL_SHM_MAGIC ^ (uint64_t)sizeof(SharedRing))    // builds with another layout refuse to attach
+#define CL_SHM_COLLECTOR_IDLE_US        1000
+#define CL_SHM_DEAD_SLOT_NS             100000000ull        // claimed slot of a dead producer is skipped after this
+#define CL_SHM_STUCK_SLOT_NS            10000000000ull      // any claimed slot is skipped after this (owner unknown or pid reused)
+#define CL_SOCKET_RETRY_NS              1000000000ull
+#define CL_REPEAT_FLUSH_NS              1000000000ull
 #define LOGGER_FORMAT_FORMAT_MESSAGE(format, ...)               sprintf(Format_Buffer, format, ##__VA_ARGS__);              \
                                                                 strcat(message_out, Format_Buffer);                         \
 
 typedef struct message_plus_thread {
     char text[MAX_MESSAGE_SIZE];
     pthread_t thread;
+    uint64_t sequence;
+    uint64_t time_ns;
+    enum log_level level;
+    pid_t pid;                          // producer process in shared mode, 0 for messages of this process
 } message_plus_thread;
 
 typedef struct MessageBuffer{
@@ -36,11 +72,111 @@ typedef struct ThreadNameMap {
     struct ThreadNameMap* prev;
 } ThreadNameMap;
 
+typedef struct OpenLogFile {
+    char name[REGISTERED_THREAD_NAME_LEN_MAX + 4];
+    int fd;                             // -1 while closed (least recently used), reopened on demand
+    uint64_t offset;                    // next write position (all writes go through this library)
+    cl_index_entry index_block;         // sidecar index entry not written yet, count == 0 if none
+    uint64_t generation;                // IO_Generation of the last use, files of the batch being filled stay open
+    int hash_next;                      // next entry in the same hash bucket
+    int lru_prev;                       // list of entries with an open fd, most recently used first
+    int lru_next;
+} OpenLogFile;
+
+typedef struct IO_Op {
+    int fd;
+    struct iovec iov;
+    uint64_t offset;
+    struct IO_Batch* batch;
+} IO_Op;
+
+typedef struct IO_Batch {
+    char data[CL_IO_BATCH_DATA_SIZE];
+    size_t used;
+    IO_Op ops[CL_IO_MAX_OPS_PER_BATCH];
+    int op_count;
+    int pending;                        // ops submitted but not completed
+} IO_Batch;
+
+typedef struct SharedRingSlot {
+    _Alignas(64) atomic_uint_fast64_t turn;
+    uint64_t sequence;
+    uint64_t time_ns;
+    uint64_t thread;
+    _Atomic(int32_t) pid;               // producer that claimed the slot, set before the payload, 0 once collected
+    int32_t level;
+    char text[MAX_MESSAGE_SIZE];
+} SharedRingSlot;
+
+typedef struct SharedRing {
+    atomic_uint_fast64_t ready;         // CL_SHM_READY once initialized
+    atomic_uint_fast64_t sequence;      // global sequence number over all processes
+    atomic_uint_fast64_t dropped;
+    _Alignas(64) atomic_uint_fast64_t enqueue_pos;
+    _Alignas(64) atomic_uint_fast64_t dequeue_pos;
+    SharedRingSlot slots[CL_SHM_RING_SLOTS];
+} SharedRing;
+
+#ifdef CL_HAS_IO_URING
+typedef struct IO_Uring {
+    int fd;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+} IO_Uring;
+#endif
+
+typedef struct LogRun {
+    char name[64];
+    uint64_t bytes;
+    time_t last_write;                  // 0 if the run has no files yet
+    bool alive;                         // the process that created the run still holds its lock file
+} LogRun;
+
 typedef struct SpecificLogLevelFormat{
     bool isInUse;
     char* Format;
 } SpecificLogLevelFormat;
 
+// Immutable snapshot of the runtime configuration (see Config_Acquire), all strings are owned by the snapshot
+typedef struct LogConfig {
+    uint64_t version;
+    char* GeneralLogFormat;
+    char* GeneralLogFormat_BACKUP;
+    SpecificLogLevelFormat SpecificLogFormat[LL_MAX_NUM];
+    enum log_level internal_level;
+    int log_level_for_buffer;
+    bool suppress_duplicates;
+    uint64_t retire_epoch;
+    struct LogConfig* next_retired;
+} LogConfig;
+
+// last message of a thread, used to collapse repeated messages
+typedef struct RepeatState {
+    bool valid;
+    enum log_level level;
+    const char* prefix;
+    const char* funcName;
+    char* fileName;
+    int Line;
+    pthread_t thread_id;
+    uint64_t repeated;
+    uint64_t first_repeat_ns;           // when the first repetition was suppressed
+    char text[MAX_MESSAGE_SIZE];
+} RepeatState;
+
+typedef struct ConfigReader {
+    atomic_uint_fast64_t epoch;         // epoch the current read started in, 0 = not reading
+    atomic_bool in_use;
+    struct ConfigReader* next;
+} ConfigReader;
+
 // ------------------------------------------------------------------------------------------ Static Var ------------------------------------------------------------------------------------------
 
 static const char* Console_Colour_Strings[LL_MAX_NUM] = {"\x1b[1;41m", "\x1b[1;31m", "\x1b[1;93m", "\x1b[1;32m", "\x1b[1;94m", "\x1b[0;37m"};
@@ -50,24 +186,77 @@ static const char* separator     = "--------------------------------------------
 static const char* separator_Big = "=======================================================================================================\n";
 static FILE* logFile;
 static pthread_mutex_t LogLock = PTHREAD_MUTEX_INITIALIZER;
-static enum log_level internal_level = Trace;
-static int log_level_for_buffer = 0;
 static MessageBuffer Log_Message_Buffer = { .count = 0 };
+static atomic_uint_fast64_t Message_Sequence = 0;
 static ThreadNameMap* firstEntry = NULL;
 static ThreadNameMap* lastEntry = NULL;
 static bool Loc_Use_separate_Files_for_every_Thread = true;
-static const char *directoryName = "./logs";
+static bool Loc_Write_File_Index = false;
+static OpenLogFile* Open_Files = NULL;
+static int Open_Files_Count = 0;
+static int Open_Files_Capacity = 0;
+static int* Open_Files_Buckets = NULL;                      // first entry of every hash bucket, 2 * Open_Files_Capacity buckets
+static int Open_Files_LRU_First = -1;
+static int Open_Files_LRU_Last = -1;
+static int Open_Files_fd_Count = 0;
+static uint64_t IO_Generation = 0;                          // incremented for every batch that is acquired
+static IO_Batch IO_Batch_Storage[CL_IO_BATCHES_IN_FLIGHT];
+static IO_Batch* IO_Batches = IO_Batch_Storage;
+static bool IO_Initialized = false;
+static bool IO_Use_Uring = false;
+#ifdef CL_HAS_IO_URING
+static IO_Uring IO_Ring;
+#endif
+static SharedRing* Shared_Ring = NULL;
+static bool Shared_Is_Producer = false;
+static bool Shared_Collector_Running = false;
+static atomic_bool Shared_Collector_Stop = false;
+static pthread_t Shared_Collector;
+static char Socket_Sink_Path[sizeof(((struct sockaddr_un*)0)->sun_path)] = "";
+static bool Socket_Sink_Datagram = false;
+static int Socket_Sink_fd = -1;
+static int32_t Socket_Sink_pid = 0;                         // pid of this process, taken when the sink connects
+static uint64_t Socket_Next_Connect_ns = 0;
+static message_plus_thread Socket_Pending_Message;
+static size_t Socket_Pending_Sent = 0;
+static bool Socket_Has_Pending = false;
+static char Log_Root[REGISTERED_THREAD_NAME_LEN_MAX / 2] = "./logs";
+static char directoryName[REGISTERED_THREAD_NAME_LEN_MAX / 2 + 64] = "./logs";
+static char Current_Run_Name[64] = "";
+static int Run_Lock_fd = -1;                                // locked (flock) as long as this process owns its run
+static bool Use_Run_Directories = true;
+static int Retention_Max_Runs = 10;
+static int Retention_Max_Age_s = 0;
+static uint64_t Retention_Max_Bytes = 0;
 static char* MainLogFileName = "unknown.txt";
-static char* m_GeneralLogFormat = "[Default] [$B$F: $G$E] - $B$C$E$Z";
-static char* m_GeneralLogFormat_BACKUP = "[Default] [$B$F: $G$E] - $B$C$E$Z";
-static SpecificLogLevelFormat SpecificLogFormatArray[] = { 
-    {false, "[$B$L$X$E] [$B$F: $G$E] - $B$C$E$Z"}, 
-    {false, "[$B$L$X$E] [$B$F: $G$E] - $B$C$E$Z"}, 
-    {false, "[$B$L$X$E] [$B$F: $G$E] - $B$C$E$Z"}, 
-    {false, "[$B$L$X$E] [$B$F: $G$E] - $B$C$E$Z"}, 
-    {false, "[$B$L$X$E] [$B$F: $G$E] - $B$C$E$Z"}, 
-    {false, "[$B$L$X$E] [$B$F: $G$E] - $B$C$E$Z"},
+static LogConfig Default_Config = {
+    .version = 0,
+    .GeneralLogFormat = "[Default] [$B$F: $G$E] - $B$C$E$Z",
+    .GeneralLogFormat_BACKUP = "[Default] [$B$F: $G$E] - $B$C$E$Z",
+    .SpecificLogFormat = {
+        {false, "[$B$L$X$E] [$B$F: $G$E] - $B$C$E$Z"}, 
+        {false, "[$B$L$X$E] [$B$F: $G$E] - $B$C$E$Z"}, 
+        {false, "[$B$L$X$E] [$B$F: $G$E] - $B$C$E$Z"}, 
+        {false, "[$B$L$X$E] [$B$F: $G$E] - $B$C$E$Z"}, 
+        {false, "[$B$L$X$E] [$B$F: $G$E] - $B$C$E$Z"}, 
+        {false, "[$B$L$X$E] [$B$F: $G$E] - $B$C$E$Z"},
+    },
+    .internal_level = Trace,
+    .log_level_for_buffer = 0,
+    .suppress_duplicates = false,
 };
+static _Atomic(LogConfig*) Current_Config = &Default_Config;
+static LogConfig* Retired_Configs = NULL;
+static pthread_mutex_t Config_Lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_uint_fast64_t Config_Epoch = 1;
+static _Atomic(ConfigReader*) Config_Readers = NULL;
+static pthread_key_t Config_Reader_Key;
+static pthread_once_t Config_Reader_Key_Once = PTHREAD_ONCE_INIT;
+static _Thread_local ConfigReader* Local_Config_Reader = NULL;
+static _Thread_local int Local_Config_Depth = 0;
+static _Thread_local RepeatState Local_Repeat;
+static pthread_key_t Repeat_Key;
+static pthread_once_t Repeat_Key_Once = PTHREAD_ONCE_INIT;
 
 
 // ------------------------------------------------------------------------------------------ private functions ------------------------------------------------------------------------------------------
@@ -75,12 +264,74 @@ static SpecificLogLevelFormat SpecificLogFormatArray[] = {
 // local Functions
 struct tm getLocalTime(void);
 void output_Message(enum log_level level, const char* message, pthread_t threadID);
+const LogConfig* Config_Acquire();
+void Config_Release();
+LogConfig* Config_Begin_Update();
+void Config_Publish(LogConfig* config);
+char* Config_Copy_String(const char* text);
+void Config_Free(LogConfig* config);
+ConfigReader* Config_Get_Reader();
+void Config_Reader_Exit(void* reader);
+void Config_Create_Reader_Key();
+void Flush_Repeated_Message();
+void Repeat_Thread_Exit(void* state);
+void Repeat_Create_Key();
+void Store_Message(enum log_level level, const char* message, pthread_t threadID, pid_t pid, uint64_t sequence, uint64_t time_ns, bool flush_by_level);
+void Flush_Message_Buffer();
+SharedRing* Shared_Ring_Attach(const char* shm_name, bool repair);
+bool Shared_Ring_Publish(SharedRing* ring, enum log_level level, const char* message, pthread_t threadID, uint64_t sequence, uint64_t time_ns);
+bool Shared_Ring_Collect(SharedRing* ring);
+bool Shared_Ring_Skip_Dead_Slot(SharedRing* ring, uint64_t* stuck_pos, uint64_t* stuck_since_ns);
+void Shared_Ring_Repair(SharedRing* ring);
+void Shared_Ring_Detach();
 void WriteMessagesToFile();
+void Write_Messages_To_Files(const message_plus_thread** messages, int count);
+int Socket_Send_Messages(const message_plus_thread** messages, int count);
+bool Socket_Send_Pending();
+bool Socket_Connect();
+void Socket_Close();
+void Socket_Build_Frame(const message_plus_thread* message, cl_socket_frame* frame);
+uint64_t Socket_Now_ns();
+int Get_Open_File(const char* filename, bool create_title_section);
+int Find_Open_File(const char* filename);
+uint32_t Open_File_Hash(const char* filename);
+void Open_File_Hash_Link(int index);
+void Open_File_Hash_Unlink(int index);
+void Open_File_LRU_Unlink(int index);
+void Open_File_LRU_Push(int index);
+bool Open_File_Reopen(int index);
+bool Close_Least_Recently_Used_File();
+void Rename_Open_File(const char* old_name, const char* new_name);
+void Close_Open_Files();
+IO_Batch* IO_Acquire_Batch();
+void IO_Append_Record(IO_Batch* batch, const message_plus_thread* message);
+void Index_Add_Block(IO_Batch* batch, int file_index, const cl_index_entry* entry, bool write_now);
+void Index_Append_Entry(IO_Batch* batch, int index_file, size_t index_start, const cl_index_entry* entry);
+void Write_Pending_Index_Blocks();
+void IO_Add_Write(IO_Batch* batch, int fd, size_t data_offset, size_t length, uint64_t file_offset);
+void IO_Submit_Batch(IO_Batch* batch, bool wait_for_completion);
+void IO_Write_Sync(IO_Op* op, size_t already_written);
+void IO_Drain();
+bool IO_Batches_Busy();
+#ifdef CL_HAS_IO_URING
+bool IO_Uring_Setup();
+void IO_Reap();
+bool IO_Uring_Wait();
+void IO_Disable_Uring();
+#endif
 bool Create_Log_File(const char* FileName);
 ThreadNameMap* add_Thread_Name_Mapping(pthread_t thread, const char* name);
 ThreadNameMap* f_find_Entry(pthread_t threadID);
 void remove_Entry(pthread_t threadID);
 int remove_all_Files_In_Directory(const char *dirName);
+int Create_Directories(const char* path);
+int Setup_Log_Directory();
+void Lock_Log_Run();
+bool Is_Run_Directory_Name(const char* name);
+bool Is_Run_Alive(const char* name);
+int Compare_Log_Runs(const void* a, const void* b);
+void Scan_Log_Run(const char* path, LogRun* run);
+void* Prune_Log_Runs(void* arg);
 
 // ------------------------------------------------------------------------------------------ Semi-inline functions ------------------------------------------------------------------------------------------
 // Print a separator "---"
@@ -98,17 +349,16 @@ void print_Separator_Big(pthread_t threadID)    { output_Message(Trace, separato
 int log_init(char* LogFileName, char* GeneralLogFormat, pthread_t threadID, int Use_separate_Files_for_every_Thread) {
 
     MainLogFileName = LogFileName;    
-    m_GeneralLogFormat = GeneralLogFormat;
-    Loc_Use_separate_Files_for_every_Thread = Use_separate_Files_for_every_Thread ? true : false;
+    LogConfig* config = Config_Begin_Update();
+    if (config != NULL) {
 
-    if (mkdir(directoryName, 0777) == 0) {
-        printf("Folder created successfully.\n");
-    } else {
-        perror("Error creating folder");
+        free(config->GeneralLogFormat);
+        config->GeneralLogFormat = Config_Copy_String(GeneralLogFormat);
+        Config_Publish(config);
     }
+    Loc_Use_separate_Files_for_every_Thread = Use_separate_Files_for_every_Thread ? true : false;
 
-    if (remove_all_Files_In_Directory(directoryName) != 0) 
-        fprintf(stderr, "Error removing files in the directory.\n");
+    Setup_Log_Directory();
 
     CL_LOG(Trace, "Initialize")
 
@@ -127,7 +377,9 @@ bool Create_Log_File(const char* FileName) {
     else {
 
         struct tm tm= getLocalTime();
-        fprintf(logFile, "[%04d/%02d/%02d - %02d:%02d:%02d] Log initialized\n    Output-file: [%s]\n    Starting-format: %s\n", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, FileName, m_GeneralLogFormat);
+        const LogConfig* config = Config_Acquire();
+        fprintf(logFile, "[%04d/%02d/%02d - %02d:%02d:%02d] Log initialized\n    Output-file: [%s]\n    Starting-format: %s\n", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, FileName, config->GeneralLogFormat);
+        Config_Release();
 
         if (LOG_LEVEL_ENABLED <= 4 || LOG_LEVEL_ENABLED >= 0) {
 
@@ -160,8 +412,29 @@ bool Create_Log_File(const char* FileName) {
 // write buffered messages to logFile and clean up output stream
 void log_shutdown(){
 
+    Flush_Repeated_Message();
     CL_LOG(Trace, "Shutdown")
+    Shared_Ring_Detach();
+
+    pthread_mutex_lock(&LogLock);
+    WriteMessagesToFile();
+    Log_Message_Buffer.count = 0;
+    pthread_mutex_unlock(&LogLock);
+    log_disconnect_socket_sink();
+
+    pthread_mutex_lock(&LogLock);
     WriteMessagesToFile();
+    Log_Message_Buffer.count = 0;
+    Write_Pending_Index_Blocks();
+    IO_Drain();
+    Close_Open_Files();
+    pthread_mutex_unlock(&LogLock);
+
+    if (Run_Lock_fd >= 0) {
+
+        close(Run_Lock_fd);
+        Run_Lock_fd = -1;
+    }
 }
 
 // Output a message to the standard output stream and a log file
@@ -188,14 +461,54 @@ void log_output(enum log_level level, const char* prefix, const char* funcName,
         vsnprintf(message_formatted, MAX_MESSAGE_SIZE, message, args_ptr);
     va_end(args_ptr);
 
+    const LogConfig* config = Config_Acquire();
+
+    // collapse consecutive identical messages of this thread into "repeated N times"
+    if (config->suppress_duplicates) {
+
+        if (Local_Repeat.valid && Local_Repeat.level == level && Local_Repeat.Line == Line && Local_Repeat.funcName == funcName
+            && Local_Repeat.prefix == prefix && strcmp(Local_Repeat.text, message_formatted) == 0) {
+
+            // a long storm is reported every CL_REPEAT_FLUSH_NS, the message itself is logged again afterwards
+            struct timespec spec;
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &spec);
+            uint64_t now = (uint64_t)spec.tv_sec * 1000000000ull + (uint64_t)spec.tv_nsec;
+            if (Local_Repeat.repeated == 0)
+                Local_Repeat.first_repeat_ns = now;
+            if (now - Local_Repeat.first_repeat_ns < CL_REPEAT_FLUSH_NS) {
+
+                Local_Repeat.repeated++;
+                Config_Release();
+                return;
+            }
+        }
+
+        // the count of a thread that exits while messages are collapsed is written by its key destructor
+        pthread_once(&Repeat_Key_Once, Repeat_Create_Key);
+        pthread_setspecific(Repeat_Key, &Local_Repeat);
+        Flush_Repeated_Message();
+        Local_Repeat.valid = true;
+        Local_Repeat.level = level;
+        Local_Repeat.prefix = prefix;
+        Local_Repeat.funcName = funcName;
+        Local_Repeat.fileName = fileName;
+        Local_Repeat.Line = Line;
+        Local_Repeat.thread_id = thread_id;
+        snprintf(Local_Repeat.text, sizeof(Local_Repeat.text), "%s", message_formatted);
+    }
+
+    // suppression was turned off while messages of this thread were collapsed
+    else if (Local_Repeat.valid)
+        Flush_Repeated_Message();
+
     // Loop over Format string and build Final Message
 
 /*#define LOGGER_FORMAT_FORMAT_MESSAGE(format, ...)     sprintf(Format_Buffer, format, ##__VA_ARGS__);
                                                         strcat(message_out, Format_Buffer);             */
 
-    char* locTargetFormat = m_GeneralLogFormat;
-    if (SpecificLogFormatArray[level].isInUse)
-        locTargetFormat = SpecificLogFormatArray[level].Format;
+    const char* locTargetFormat = config->GeneralLogFormat;
+    if (config->SpecificLogFormat[level].isInUse)
+        locTargetFormat = config->SpecificLogFormat[level].Format;
 
     int FormatLen = strlen(locTargetFormat);
     for (int x = 0; x < FormatLen; x++) {
@@ -327,27 +640,61 @@ void log_output(enum log_level level, const char* prefix, const char* funcName,
     }
     
     output_Message(level, (const char*)message_out, thread_id);
+    Config_Release();
 }
 
 //
 void output_Message(enum log_level level, const char* message, pthread_t threadID) {
     
+    // Stamp message with global sequence number and exact time
+    struct timespec spec;
+    clock_gettime(CLOCK_REALTIME, &spec);
+    uint64_t time_ns = (uint64_t)spec.tv_sec * 1000000000ull + (uint64_t)spec.tv_nsec;
+    SharedRing* ring = Shared_Ring;
+    uint64_t sequence = (ring != NULL) ? atomic_fetch_add_explicit(&ring->sequence, 1, memory_order_relaxed)
+                                       : atomic_fetch_add_explicit(&Message_Sequence, 1, memory_order_relaxed);
+
     // Print Message to standard output
-    if (level <= internal_level) {
+    const LogConfig* config = Config_Acquire();
+    enum log_level console_level = config->internal_level;
+    Config_Release();
+    if (level <= console_level) {
 
         printf("%s", message);
         fflush(stdout);
     }
 
+    // the collector process owns the files
+    if (Shared_Is_Producer && ring != NULL) {
+
+        Shared_Ring_Publish(ring, level, message, threadID, sequence, time_ns);
+        return;
+    }
+
+    Store_Message(level, message, threadID, 0, sequence, time_ns, true);
+}
+
+// Save message in Buffer and write buffer to file if needed
+// [flush_by_level] false: only flush if the buffer is full or for FATAL, the caller flushes with Flush_Message_Buffer()
+void Store_Message(enum log_level level, const char* message, pthread_t threadID, pid_t pid, uint64_t sequence, uint64_t time_ns, bool flush_by_level) {
+
     pthread_mutex_lock(&LogLock);
     // Save message in Buffer
     strncpy(Log_Message_Buffer.messages[Log_Message_Buffer.count].text, message, sizeof(Log_Message_Buffer.messages[0].text));
     Log_Message_Buffer.messages[Log_Message_Buffer.count].text[sizeof(Log_Message_Buffer.messages[Log_Message_Buffer.count].text) - 1] = '\0';
     Log_Message_Buffer.messages[Log_Message_Buffer.count].thread = threadID;
+    Log_Message_Buffer.messages[Log_Message_Buffer.count].pid = pid;
+    Log_Message_Buffer.messages[Log_Message_Buffer.count].sequence = sequence;
+    Log_Message_Buffer.messages[Log_Message_Buffer.count].time_ns = time_ns;
+    Log_Message_Buffer.messages[Log_Message_Buffer.count].level = level;
     Log_Message_Buffer.count++;
 
     // Check if buffer full OR important message
-    if (Log_Message_Buffer.count >= (MAX_BUFFERED_MESSAGES -1) || level < (6 - (unsigned int)log_level_for_buffer)) {
+    const LogConfig* config = Config_Acquire();
+    int buffer_level = config->log_level_for_buffer;
+    Config_Release();
+    bool important = flush_by_level ? level < (6 - (unsigned int)buffer_level) : level == Fatal;
+    if (Log_Message_Buffer.count >= (MAX_BUFFERED_MESSAGES -1) || important) {
         
         WriteMessagesToFile();
         Log_Message_Buffer.count = 0;
@@ -356,254 +703,1948 @@ void output_Message(enum log_level level, const char* message, pthread_t threadI
     pthread_mutex_unlock(&LogLock); 
 }
 
-//
+// Write all buffered messages
+void Flush_Message_Buffer() {
+
+    pthread_mutex_lock(&LogLock);
+    WriteMessagesToFile();
+    Log_Message_Buffer.count = 0;
+    pthread_mutex_unlock(&LogLock);
+}
+
+// Write all buffered messages, to the socket sink if connected, everything it could not take goes to the log files
 void WriteMessagesToFile() {
 
+    const message_plus_thread* messages[MAX_BUFFERED_MESSAGES + 1];
+    int count = 0;
+    for (int x = 0; x < Log_Message_Buffer.count; x++)
+        messages[count++] = &Log_Message_Buffer.messages[x];
+
+    if (Socket_Sink_Path[0] != '\0')
+        count = Socket_Send_Messages(messages, count);
+
+    Write_Messages_To_Files(messages, count);
+}
+
+// Render [messages] into one I/O batch (one contiguous write per destination file) and submit it
+void Write_Messages_To_Files(const message_plus_thread** messages, int count) {
+
+    if (count <= 0)
+        return;
+
+    IO_Batch* batch = IO_Acquire_Batch();
+    int file_of_message[MAX_BUFFERED_MESSAGES + 1];
+    bool contains_fatal = false;
+    int dropped = 0;
     ThreadNameMap* loc_Entry = NULL;
     char filename[REGISTERED_THREAD_NAME_LEN_MAX];
-    for (int x = 0; x < Log_Message_Buffer.count; x++) {
+    for (int x = 0; x < count; x++) {
 
+        loc_Entry = NULL;
         if(Loc_Use_separate_Files_for_every_Thread) {
 
-            loc_Entry = f_find_Entry(Log_Message_Buffer.messages[x].thread);
-            if(loc_Entry != NULL) {
+            if (messages[x]->pid != 0)
+                loc_Entry = NULL;
+            else
+                loc_Entry = f_find_Entry(messages[x]->thread);
 
+            if(loc_Entry != NULL) 
                 snprintf(filename, sizeof(filename), "%s", loc_Entry->name);
-            }
-            else {
-
-                //printf("    loc_Entry: %s [tread: %lu]\n", ptr_To_String(loc_Entry), Log_Message_Buffer.messages[x].thread);
-                snprintf(filename, sizeof(filename), "%s/thread_log_%lu.log", directoryName, (unsigned long)Log_Message_Buffer.messages[x].thread);
-                if(access(filename, F_OK) != 0) 
-                    Create_Log_File(filename);
-            }
+            else if (messages[x]->pid != 0)
+                snprintf(filename, sizeof(filename), "%s/process_%d_thread_log_%lu.log", directoryName, (int)messages[x]->pid, (unsigned long)messages[x]->thread);
+            else
+                snprintf(filename, sizeof(filename), "%s/thread_log_%lu.log", directoryName, (unsigned long)messages[x]->thread);
         }
 
-        else {
-
+        else
             snprintf(filename, sizeof(filename), "%s/%s.log", directoryName, MainLogFileName);
-            if(access(filename, F_OK) != 0) 
-                Create_Log_File(filename);
-        }
-        
 
-        // Open the file for writing (append mode)
-        FILE* file = fopen(filename, "a");
-        if (file == NULL) {
+        // registered files are not created with a title section
+        file_of_message[x] = Get_Open_File(filename, loc_Entry == NULL);
+        if (file_of_message[x] < 0)
+            dropped++;
+        if (messages[x]->level == Fatal)
+            contains_fatal = true;
+    }
+
+    for (int x = 0; x < count; x++) {
 
-            // perror("Error opening the file");
+        int file_index = file_of_message[x];
+        if (file_index < 0)
             continue;
+
+        // collect all messages for this file
+        size_t start = batch->used;
+        cl_index_entry entry = { .offset = Open_Files[file_index].offset, .time_first_ns = UINT64_MAX };
+        for (int y = x; y < count; y++) {
+
+            if (file_of_message[y] != file_index)
+                continue;
+
+            const message_plus_thread* message = messages[y];
+            IO_Append_Record(batch, message);
+            entry.time_first_ns = MIN(entry.time_first_ns, message->time_ns);
+            entry.time_last_ns = MAX(entry.time_last_ns, message->time_ns);
+            entry.level_mask |= 1u << message->level;
+            entry.count++;
+            file_of_message[y] = -1;
         }
-        
-        fputs((const char*)Log_Message_Buffer.messages[x].text, file); 
-        fclose(file);
+
+        entry.length = batch->used - start;
+        IO_Add_Write(batch, Open_Files[file_index].fd, start, entry.length, Open_Files[file_index].offset);
+        Open_Files[file_index].offset += entry.length;
+
+        if (Loc_Write_File_Index)
+            Index_Add_Block(batch, file_index, &entry, contains_fatal);
     }
+
+    if (dropped > 0)
+        fprintf(stderr, "Dropped %d log messages, their file could not be opened\n", dropped);
+
+    // a FATAL message is most likely followed by a crash, make sure it reached the file
+    IO_Submit_Batch(batch, contains_fatal);
 }
 
-// 
-int register_thread_log_under_Name(pthread_t threadID, const char* name) {
+// ------------------------------------------------------------------------------------------ Open Files ------------------------------------------------------------------------------------------
 
-    char filename[REGISTERED_THREAD_NAME_LEN_MAX];
-    snprintf(filename, sizeof(filename), "%s/thread_log_%lu.log", directoryName, (unsigned long)threadID);
+// At most CL_MAX_OPEN_FILES log and index files are kept open, the least recently used one is closed beyond that
+// (its entry with offset and pending index block stays) and reopened when it is written again. Entries are found
+// through a hash table, all of this runs under LogLock.
 
-    char newFilename[REGISTERED_THREAD_NAME_LEN_MAX];
-    snprintf(newFilename, sizeof(newFilename), "%s/%s.log", directoryName, name);
+// Returns the index of [filename] in [Open_Files], opens (and creates) the file if needed // Returns -1 on failure
+int Get_Open_File(const char* filename, bool create_title_section) {
 
-    // Create a new entry in list
-    add_Thread_Name_Mapping(threadID, newFilename);
+    int index = Find_Open_File(filename);
+    if (index >= 0) {
 
-    if (access(filename, F_OK) != 0)
+        if (Open_Files[index].fd >= 0)
+            Open_File_LRU_Unlink(index);
+        else if (!Open_File_Reopen(index))
+            return -1;
+
+        Open_File_LRU_Push(index);
+        Open_Files[index].generation = IO_Generation;
+        return index;
+    }
+
+    if (create_title_section && access(filename, F_OK) != 0) 
+        Create_Log_File(filename);
+
+    if (Open_Files_Count >= Open_Files_Capacity) {
+
+        int new_capacity = MAX(16, Open_Files_Capacity * 2);
+        OpenLogFile* new_array = realloc(Open_Files, sizeof(OpenLogFile) * (size_t)new_capacity);
+        if (new_array == NULL) {
+
+            printf("  Memory allocation failed\n");
+            return -1;
+        }
+        Open_Files = new_array;
+        Open_Files_Capacity = new_capacity;
+
+        int* new_buckets = realloc(Open_Files_Buckets, sizeof(int) * 2 * (size_t)new_capacity);
+        if (new_buckets == NULL) {
+
+            printf("  Memory allocation failed\n");
+            return -1;
+        }
+        Open_Files_Buckets = new_buckets;
+        for (int x = 0; x < 2 * new_capacity; x++)
+            Open_Files_Buckets[x] = -1;
+        for (int x = 0; x < Open_Files_Count; x++)
+            Open_File_Hash_Link(x);
+    }
+
+    index = Open_Files_Count;
+    OpenLogFile* file = &Open_Files[index];
+    snprintf(file->name, sizeof(file->name), "%s", filename);
+    file->fd = -1;
+    file->offset = 0;
+    memset(&file->index_block, 0, sizeof(file->index_block));
+    if (!Open_File_Reopen(index))
         return -1;
 
-    int result = rename(filename, newFilename);
-    if (result != 0) 
+    Open_Files_Count++;
+    Open_File_Hash_Link(index);
+    Open_File_LRU_Push(index);
+    file->generation = IO_Generation;
+    return index;
+}
+
+// Returns the index of [filename] in [Open_Files] or -1
+int Find_Open_File(const char* filename) {
+
+    if (Open_Files_Count == 0)
         return -1;
 
-    return 0;
+    for (int x = Open_Files_Buckets[Open_File_Hash(filename) & (uint32_t)(2 * Open_Files_Capacity - 1)]; x >= 0; x = Open_Files[x].hash_next)
+        if (strcmp(Open_Files[x].name, filename) == 0)
+            return x;
+    return -1;
 }
 
-// ------------------------------------------------------------------------------------------ Thread-Name Mapping ------------------------------------------------------------------------------------------
+// FNV-1a
+uint32_t Open_File_Hash(const char* filename) {
 
-//
-ThreadNameMap* add_Thread_Name_Mapping(pthread_t thread, const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const char* pos = filename; *pos != '\0'; pos++)
+        hash = (hash ^ (uint8_t)*pos) * 16777619u;
+    return hash;
+}
 
-    ThreadNameMap* loc_Found = f_find_Entry(thread);
-    if(loc_Found != NULL) {
+void Open_File_Hash_Link(int index) {
 
-        //printf("  thread already has an Entry in [ThreadNameMap], [name] was updated");
-        strncpy(loc_Found->name, name, MIN(strlen(name), REGISTERED_THREAD_NAME_LEN_MAX));
-        return loc_Found;
-    }
+    int* bucket = &Open_Files_Buckets[Open_File_Hash(Open_Files[index].name) & (uint32_t)(2 * Open_Files_Capacity - 1)];
+    Open_Files[index].hash_next = *bucket;
+    *bucket = index;
+}
 
-    ThreadNameMap* newEntry = (ThreadNameMap*) malloc(sizeof(ThreadNameMap));
-    if (newEntry == NULL) {
-        
-        printf("  Memory allocation failed\n");
-        return NULL;
-    }
+void Open_File_Hash_Unlink(int index) {
 
-    memset(newEntry, 0, sizeof(ThreadNameMap));
-    strncpy(newEntry->name, name, MIN(strlen(name), REGISTERED_THREAD_NAME_LEN_MAX));
-    newEntry->thread_id = thread;
-    
-    if (firstEntry == NULL) {   // list is Empty
+    int* link = &Open_Files_Buckets[Open_File_Hash(Open_Files[index].name) & (uint32_t)(2 * Open_Files_Capacity - 1)];
+    while (*link >= 0 && *link != index)
+        link = &Open_Files[*link].hash_next;
+    if (*link == index)
+        *link = Open_Files[index].hash_next;
+}
 
-        firstEntry = newEntry;
-        lastEntry = newEntry;
-    
-    } else {                      // Add to List-End
+void Open_File_LRU_Unlink(int index) {
 
-        lastEntry->next = newEntry;
-        newEntry->prev = lastEntry;
-        lastEntry = newEntry;
-    }
-    
-    return newEntry;
+    OpenLogFile* file = &Open_Files[index];
+    if (file->lru_prev >= 0)
+        Open_Files[file->lru_prev].lru_next = file->lru_next;
+    else
+        Open_Files_LRU_First = file->lru_next;
+
+    if (file->lru_next >= 0)
+        Open_Files[file->lru_next].lru_prev = file->lru_prev;
+    else
+        Open_Files_LRU_Last = file->lru_prev;
 }
 
-// removes entry from linked list, if found
-void remove_Entry(pthread_t threadID) {
+void Open_File_LRU_Push(int index) {
 
-    pthread_mutex_lock(&LogLock);
-    ThreadNameMap *locPointer = f_find_Entry(threadID);
-    if (locPointer == NULL)
-        return;
-    
-    if (firstEntry == lastEntry) {          // List has only one element
+    Open_Files[index].lru_prev = -1;
+    Open_Files[index].lru_next = Open_Files_LRU_First;
+    if (Open_Files_LRU_First >= 0)
+        Open_Files[Open_Files_LRU_First].lru_prev = index;
+    else
+        Open_Files_LRU_Last = index;
+    Open_Files_LRU_First = index;
+}
 
-        firstEntry = NULL;
-        lastEntry = NULL;
+// (Re)open the file of entry [index] and continue at its end, closes the least recently used file if needed
+// The caller links the entry into the LRU list
+bool Open_File_Reopen(int index) {
+
+    OpenLogFile* file = &Open_Files[index];
+    if (Open_Files_fd_Count >= CL_MAX_OPEN_FILES)
+        Close_Least_Recently_Used_File();
+
+    int fd = open(file->name, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0 && (errno == EMFILE || errno == ENFILE) && Close_Least_Recently_Used_File())
+        fd = open(file->name, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+
+        fprintf(stderr, "Error opening log file [%s]: %s\n", file->name, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return false;
     }
 
-    // List has more than one element
-    else {
+    file->fd = fd;
+    file->offset = (uint64_t)st.st_size;
+    Open_Files_fd_Count++;
+    return true;
+}
 
-        if (locPointer == firstEntry){      // Is First?
+// Close the least recently used file that is not part of the batch being filled // Returns false if there is none
+// Writes in flight might still use its fd (a short write is finished with it), they are waited for first
+bool Close_Least_Recently_Used_File() {
 
-            firstEntry = firstEntry->next;
-            firstEntry->prev = NULL;
-        
-        } else if (locPointer == lastEntry) { // Is Last?
+    int index = Open_Files_LRU_Last;
+    if (index < 0 || Open_Files[index].generation == IO_Generation)
+        return false;
 
-            lastEntry = lastEntry->prev;
-            lastEntry->next = NULL;
-        
-        } else {                              // is in middle
+    IO_Drain();
+    Open_File_LRU_Unlink(index);
+    close(Open_Files[index].fd);
+    Open_Files[index].fd = -1;
+    Open_Files_fd_Count--;
+    return true;
+}
 
-            locPointer->prev->next = locPointer->next;
-            locPointer->next->prev = locPointer->prev;
-        }
-    }
+// Keep the cached entry in sync when a log file is renamed
+void Rename_Open_File(const char* old_name, const char* new_name) {
 
-    free(locPointer);
-    pthread_mutex_unlock(&LogLock);
+    int index = Find_Open_File(old_name);
+    if (index < 0)
+        return;
+
+    Open_File_Hash_Unlink(index);
+    snprintf(Open_Files[index].name, sizeof(Open_Files[index].name), "%s", new_name);
+    Open_File_Hash_Link(index);
 }
 
-// Iterate through list and try to find entry by thread // Returns NULL if not found
-ThreadNameMap* f_find_Entry(pthread_t threadID) {
-    
-    //printf("    f_find_Entry()  [thread: %lu]\n", threadID);
-    bool locFound = false;
-    ThreadNameMap *locPointer = firstEntry;
-    while (locFound == false && locPointer != NULL) {
+void Close_Open_Files() {
+
+    for (int x = 0; x < Open_Files_Count; x++)
+        if (Open_Files[x].fd >= 0)
+            close(Open_Files[x].fd);
+
+    free(Open_Files);
+    free(Open_Files_Buckets);
+    Open_Files = NULL;
+    Open_Files_Buckets = NULL;
+    Open_Files_Count = 0;
+    Open_Files_Capacity = 0;
+    Open_Files_LRU_First = -1;
+    Open_Files_LRU_Last = -1;
+    Open_Files_fd_Count = 0;
+}
 
-        //printf("    Iterating over Entry List current Entry.thread: %lu] [next: %s]\n", locPointer->thread_id, ptr_To_String(locPointer->next));
+// ------------------------------------------------------------------------------------------ I/O Backend ------------------------------------------------------------------------------------------
 
-        if (locPointer->thread_id == threadID)
-            locFound = true;
-        else
-            locPointer = locPointer->next;
+// Writes are collected in batches, a batch is submitted with a single io_uring_enter() and completes asynchronously.
+// Up to CL_IO_BATCHES_IN_FLIGHT batches can be in flight, the calling thread only waits if all of them are busy.
+// Without io_uring (old kernel, seccomp, ...) every write of a batch is done synchronously with pwritev().
+
+// copy one message (with record stamp in per-thread mode or if the index is written) into the batch
+void IO_Append_Record(IO_Batch* batch, const message_plus_thread* message) {
+
+    size_t text_len = strlen(message->text);
+    if(Loc_Use_separate_Files_for_every_Thread || Loc_Write_File_Index) {
+
+        batch->used += (size_t)snprintf(batch->data + batch->used, CL_RECORD_STAMP_LEN + 1, CL_RECORD_STAMP_FORMAT, message->sequence, message->time_ns, (unsigned int)message->level);
+        memcpy(batch->data + batch->used, message->text, text_len);
+        batch->used += text_len;
+        if (text_len == 0 || message->text[text_len - 1] != '\n')
+            batch->data[batch->used++] = '\n';
     }
+    else {
 
-    return locFound ? locPointer : NULL;
+        memcpy(batch->data + batch->used, message->text, text_len);
+        batch->used += text_len;
+    }
 }
 
-// ------------------------------------------------------------------------------------------ Formatting ------------------------------------------------------------------------------------------
+void IO_Add_Write(IO_Batch* batch, int fd, size_t data_offset, size_t length, uint64_t file_offset) {
 
-// Change Format of log messages and backup previous Format
-void set_Formatting(char* LogFormat) {
+    if (length == 0 || batch->op_count >= CL_IO_MAX_OPS_PER_BATCH)
+        return;
 
-    m_GeneralLogFormat_BACKUP = m_GeneralLogFormat;
-    m_GeneralLogFormat = LogFormat;
+    IO_Op* op = &batch->ops[batch->op_count++];
+    op->fd = fd;
+    op->iov.iov_base = batch->data + data_offset;
+    op->iov.iov_len = length;
+    op->offset = file_offset;
+    op->batch = batch;
 }
 
-// Sets the Backup version of Format to be used as Main Format
-void use_Formatting_Backup() {
+// write the (remaining) bytes of [op] in the calling thread
+void IO_Write_Sync(IO_Op* op, size_t already_written) {
 
-    m_GeneralLogFormat = m_GeneralLogFormat_BACKUP;
-}
+    struct iovec iov = { .iov_base = (char*)op->iov.iov_base + already_written, .iov_len = op->iov.iov_len - already_written };
+    off_t offset = (off_t)(op->offset + already_written);
+    while (iov.iov_len > 0) {
 
-//
-void Set_Format_For_Specific_Log_Level(enum log_level level, char* Format) {
+        ssize_t result = pwritev(op->fd, &iov, 1, offset);
+        if (result < 0 && errno == EINTR)
+            continue;
 
-    SpecificLogFormatArray[level].isInUse = true;
-    SpecificLogFormatArray[level].Format = Format;
+        if (result <= 0) {
+
+            fprintf(stderr, "Error writing log file: %s\n", strerror(result < 0 ? errno : EIO));
+            return;
+        }
+        iov.iov_base = (char*)iov.iov_base + result;
+        iov.iov_len -= (size_t)result;
+        offset += result;
+    }
 }
 
-//
-void Disable_Format_For_Specific_Log_Level(enum log_level level) {
+#ifdef CL_HAS_IO_URING
+
+static int IO_Uring_Enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
 
-    SpecificLogFormatArray[level].isInUse = false;
+    return (int)syscall(__NR_io_uring_enter, IO_Ring.fd, to_submit, min_complete, flags, NULL, 0);
 }
 
-// ------------------------------------------------------------------------------------------ Misc ------------------------------------------------------------------------------------------
+bool IO_Uring_Setup() {
 
-// get system time
-struct tm getLocalTime(void) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, CL_IO_URING_ENTRIES, &params);
+    if (fd < 0)
+        return false;
 
-    time_t t = time(NULL);
-    struct tm tm = *localtime(&t);
-    return tm;
+    size_t sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        sq_ring_size = cq_ring_size = MAX(sq_ring_size, cq_ring_size);
+
+    char* sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    char* cq_ring = sq_ring;
+    if (sq_ring != MAP_FAILED && !(params.features & IORING_FEAT_SINGLE_MMAP))
+        cq_ring = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+
+    struct io_uring_sqe* sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED) {
+
+        close(fd);
+        return false;
+    }
+
+    IO_Ring.fd = fd;
+    IO_Ring.sq_head = (unsigned*)(sq_ring + params.sq_off.head);
+    IO_Ring.sq_tail = (unsigned*)(sq_ring + params.sq_off.tail);
+    IO_Ring.sq_mask = (unsigned*)(sq_ring + params.sq_off.ring_mask);
+    IO_Ring.sq_array = (unsigned*)(sq_ring + params.sq_off.array);
+    IO_Ring.sqes = sqes;
+    IO_Ring.cq_head = (unsigned*)(cq_ring + params.cq_off.head);
+    IO_Ring.cq_tail = (unsigned*)(cq_ring + params.cq_off.tail);
+    IO_Ring.cq_mask = (unsigned*)(cq_ring + params.cq_off.ring_mask);
+    IO_Ring.cqes = (struct io_uring_cqe*)(cq_ring + params.cq_off.cqes);
+    return true;
 }
 
-//
-void set_buffer_Level(int newLevel) {
+// handle all available completions without entering the kernel
+void IO_Reap() {
 
-    if( newLevel <= 4 && newLevel >= 0)
-        log_level_for_buffer = newLevel;
+    unsigned head = *IO_Ring.cq_head;
+    unsigned tail = __atomic_load_n(IO_Ring.cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
 
-    else 
-        CL_LOG(Error, "Input invalid Level (0 <= newLevel <= 4), input: %d", newLevel)
+        struct io_uring_cqe* cqe = &IO_Ring.cqes[head & *IO_Ring.cq_mask];
+        IO_Op* op = (IO_Op*)(uintptr_t)cqe->user_data;
+
+        // failed or short write: finish it synchronously
+        if (cqe->res < 0)
+            IO_Write_Sync(op, 0);
+        else if ((size_t)cqe->res < op->iov.iov_len)
+            IO_Write_Sync(op, (size_t)cqe->res);
+
+        op->batch->pending--;
+        head++;
+    }
+    __atomic_store_n(IO_Ring.cq_head, head, __ATOMIC_RELEASE);
 }
 
-// Set what leg level should be printed to terminal
-// CAUTION! this only applies to log levels that are enabled be LOG_LEVEL_ENABLED
-void set_log_level(enum log_level new_level) {
+// wait for at least one completion, returns false if the ring is broken
+bool IO_Uring_Wait() {
 
-    CL_VALIDATE(new_level < LL_MAX_NUM && new_level > Fatal, "", "Selected log level is out of bounds (1 <= [new_level: %d] <= 5)", return, new_level)
+    while (IO_Uring_Enter(0, 1, IORING_ENTER_GETEVENTS) < 0) {
 
-    CL_LOG(Trace, "Setting [log_level: %s]", level_str[new_level])
-    internal_level = new_level;
+        if (errno != EINTR)
+            return false;
+    }
+    return true;
 }
 
-//
-int remove_all_Files_In_Directory(const char *dirName) {
+// Switch to synchronous writes for good. Completions still show up in the completion queue without io_uring_enter(),
+// give the kernel a moment to finish what it accepted. Batches that are still in flight after that are written again
+// synchronously (all writes have an explicit offset, repeating one is harmless) and never reused, the kernel might still read them.
+void IO_Disable_Uring() {
 
-    DIR *dir = opendir(dirName);
-    if (dir == NULL) {
-        perror("Error opening directory");
-        return -1;
+    for (int x = 0; x < CL_IO_DISABLE_WAIT_MS && IO_Batches_Busy(); x++) {
+
+        if (!IO_Uring_Wait())
+            usleep(1000);
+        IO_Reap();
     }
 
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL) {
+    if (IO_Batches_Busy()) {
 
-        if (entry->d_type == DT_REG) {
-        
-            // It's a regular file, remove it
-            char filepath[REGISTERED_THREAD_NAME_LEN_MAX *2];
-            snprintf(filepath, sizeof(filepath), "%s/%s", dirName, entry->d_name);
+        for (int x = 0; x < CL_IO_BATCHES_IN_FLIGHT; x++)
+            for (int y = 0; y < IO_Batches[x].op_count && IO_Batches[x].pending > 0; y++)
+                IO_Write_Sync(&IO_Batches[x].ops[y], 0);
 
-            if (remove(filepath) != 0) {
-                perror("Error removing file");
-                closedir(dir);
-                return -1;
-            }
-        }
+        IO_Batch* fresh_batches = calloc(CL_IO_BATCHES_IN_FLIGHT, sizeof(IO_Batch));
+        if (fresh_batches != NULL)
+            IO_Batches = fresh_batches;
+        for (int x = 0; x < CL_IO_BATCHES_IN_FLIGHT; x++)
+            IO_Batches[x].pending = 0;
     }
 
-    closedir(dir);
-    return 0;
+    fprintf(stderr, "io_uring failed, falling back to synchronous log writes\n");
+    close(IO_Ring.fd);
+    IO_Use_Uring = false;
+}
+
+#endif
+
+// Returns a batch that is not in flight, waits for completions if all are busy
+IO_Batch* IO_Acquire_Batch() {
+
+    if (!IO_Initialized) {
+
+#ifdef CL_HAS_IO_URING
+        IO_Use_Uring = IO_Uring_Setup();
+#endif
+        IO_Initialized = true;
+    }
+
+    while (true) {
+
+#ifdef CL_HAS_IO_URING
+        if (IO_Use_Uring)
+            IO_Reap();
+#endif
+
+        for (int x = 0; x < CL_IO_BATCHES_IN_FLIGHT; x++) {
+
+            if (IO_Batches[x].pending == 0) {
+
+                IO_Generation++;
+                IO_Batches[x].used = 0;
+                IO_Batches[x].op_count = 0;
+                return &IO_Batches[x];
+            }
+        }
+
+#ifdef CL_HAS_IO_URING
+        if (IO_Use_Uring && !IO_Uring_Wait())
+            IO_Disable_Uring();
+#endif
+    }
+}
+
+// Submit all writes of [batch] in one go, [wait_for_completion] also waits for every batch in flight
+void IO_Submit_Batch(IO_Batch* batch, bool wait_for_completion) {
+
+    if (batch->op_count == 0)
+        return;
+
+#ifdef CL_HAS_IO_URING
+    if (IO_Use_Uring) {
+
+        unsigned tail = *IO_Ring.sq_tail;
+        for (int x = 0; x < batch->op_count; x++) {
+
+            unsigned index = tail & *IO_Ring.sq_mask;
+            struct io_uring_sqe* sqe = &IO_Ring.sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_WRITEV;
+            sqe->fd = batch->ops[x].fd;
+            sqe->addr = (uint64_t)(uintptr_t)&batch->ops[x].iov;
+            sqe->len = 1;
+            sqe->off = batch->ops[x].offset;
+            sqe->user_data = (uint64_t)(uintptr_t)&batch->ops[x];
+            IO_Ring.sq_array[index] = index;
+            tail++;
+        }
+        batch->pending = batch->op_count;
+        __atomic_store_n(IO_Ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+        unsigned to_submit = (unsigned)batch->op_count;
+        while (to_submit > 0) {
+
+            int result = IO_Uring_Enter(to_submit, 0, 0);
+            if (result < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+
+                IO_Reap();
+                continue;
+            }
+            if (result < 0) {
+
+                // the kernel consumes entries in order, take back the ones it did not get and write them here
+                fprintf(stderr, "Error submitting log writes: %s\n", strerror(errno));
+                __atomic_store_n(IO_Ring.sq_tail, tail - to_submit, __ATOMIC_RELEASE);
+                for (int x = batch->op_count - (int)to_submit; x < batch->op_count; x++)
+                    IO_Write_Sync(&batch->ops[x], 0);
+                batch->pending -= (int)to_submit;
+                IO_Disable_Uring();
+                return;
+            }
+            to_submit -= (unsigned)result;
+        }
+
+        if (wait_for_completion)
+            IO_Drain();
+        return;
+    }
+#endif
+
+    (void)wait_for_completion;
+    for (int x = 0; x < batch->op_count; x++)
+        IO_Write_Sync(&batch->ops[x], 0);
+}
+
+bool IO_Batches_Busy() {
+
+    for (int x = 0; x < CL_IO_BATCHES_IN_FLIGHT; x++)
+        if (IO_Batches[x].pending > 0)
+            return true;
+    return false;
+}
+
+// Wait until every batch in flight is written
+void IO_Drain() {
+
+#ifdef CL_HAS_IO_URING
+    if (!IO_Use_Uring)
+        return;
+
+    while (true) {
+
+        IO_Reap();
+        if (!IO_Batches_Busy())
+            return;
+
+        if (!IO_Uring_Wait()) {
+
+            IO_Disable_Uring();
+            return;
+        }
+    }
+#endif
+}
+
+// ------------------------------------------------------------------------------------------ Sidecar Index ------------------------------------------------------------------------------------------
+
+// Consecutive flushes of a log file are merged into one index block, its entry is written once the block reaches
+// CL_INDEX_BLOCK_BYTES or spans CL_INDEX_BLOCK_NS, before a FATAL message and on log_shutdown().
+// Records behind the last entry are not indexed yet, cl-query scans them completely.
+
+// copy [entry] into the batch (with the magic if the index file is new) as one write to [index_file]
+void Index_Append_Entry(IO_Batch* batch, int index_file, size_t index_start, const cl_index_entry* entry) {
+
+    if (Open_Files[index_file].offset == 0 && batch->used == index_start) {
+
+        memcpy(batch->data + batch->used, CL_INDEX_MAGIC, CL_INDEX_MAGIC_LEN);
+        batch->used += CL_INDEX_MAGIC_LEN;
+    }
+    memcpy(batch->data + batch->used, entry, sizeof(*entry));
+    batch->used += sizeof(*entry);
+}
+
+// Merge [entry] (one flush of the log file [file_index]) into its pending index block
+void Index_Add_Block(IO_Batch* batch, int file_index, const cl_index_entry* entry, bool write_now) {
+
+    char index_filename[sizeof(Open_Files[0].name) + 4];
+    snprintf(index_filename, sizeof(index_filename), "%s.idx", Open_Files[file_index].name);
+    int index_file = Get_Open_File(index_filename, false);
+    if (index_file < 0)
+        return;
+
+    // the file was written while the index was disabled, the pending block ends here
+    size_t index_start = batch->used;
+    cl_index_entry* block = &Open_Files[file_index].index_block;
+    if (block->count > 0 && block->offset + block->length != entry->offset) {
+
+        Index_Append_Entry(batch, index_file, index_start, block);
+        block->count = 0;
+    }
+
+    if (block->count == 0)
+        *block = *entry;
+    else {
+
+        block->length += entry->length;
+        block->time_first_ns = MIN(block->time_first_ns, entry->time_first_ns);
+        block->time_last_ns = MAX(block->time_last_ns, entry->time_last_ns);
+        block->level_mask |= entry->level_mask;
+        block->count += entry->count;
+    }
+
+    if (write_now || block->length >= CL_INDEX_BLOCK_BYTES || block->time_last_ns - block->time_first_ns >= CL_INDEX_BLOCK_NS) {
+
+        Index_Append_Entry(batch, index_file, index_start, block);
+        block->count = 0;
+    }
+
+    if (batch->used > index_start) {
+
+        IO_Add_Write(batch, Open_Files[index_file].fd, index_start, batch->used - index_start, Open_Files[index_file].offset);
+        Open_Files[index_file].offset += batch->used - index_start;
+    }
+}
+
+// Write the pending index block of every open log file
+void Write_Pending_Index_Blocks() {
+
+    IO_Batch* batch = NULL;
+    for (int x = 0; x < Open_Files_Count; x++) {
+
+        if (Open_Files[x].index_block.count == 0)
+            continue;
+
+        if (batch != NULL && (batch->op_count >= CL_IO_MAX_OPS_PER_BATCH || batch->used + CL_INDEX_MAGIC_LEN + sizeof(cl_index_entry) > CL_IO_BATCH_DATA_SIZE)) {
+
+            IO_Submit_Batch(batch, false);
+            batch = NULL;
+        }
+        if (batch == NULL)
+            batch = IO_Acquire_Batch();
+
+        char index_filename[sizeof(Open_Files[0].name) + 4];
+        snprintf(index_filename, sizeof(index_filename), "%s.idx", Open_Files[x].name);
+        int index_file = Get_Open_File(index_filename, false);
+        if (index_file < 0)
+            continue;
+
+        size_t index_start = batch->used;
+        Index_Append_Entry(batch, index_file, index_start, &Open_Files[x].index_block);
+        Open_Files[x].index_block.count = 0;
+        IO_Add_Write(batch, Open_Files[index_file].fd, index_start, batch->used - index_start, Open_Files[index_file].offset);
+        Open_Files[index_file].offset += batch->used - index_start;
+    }
+
+    if (batch != NULL)
+        IO_Submit_Batch(batch, false);
+}
+
+//
+void set_File_Index(int enable) {
+
+    pthread_mutex_lock(&LogLock);
+    Loc_Write_File_Index = enable ? true : false;
+    pthread_mutex_unlock(&LogLock);
+}
+
+// 
+int register_thread_log_under_Name(pthread_t threadID, const char* name) {
+
+    char filename[REGISTERED_THREAD_NAME_LEN_MAX];
+    snprintf(filename, sizeof(filename), "%s/thread_log_%lu.log", directoryName, (unsigned long)threadID);
+
+    char newFilename[REGISTERED_THREAD_NAME_LEN_MAX];
+    snprintf(newFilename, sizeof(newFilename), "%s/%s.log", directoryName, name);
+
+    // Create a new entry in list
+    add_Thread_Name_Mapping(threadID, newFilename);
+
+    if (access(filename, F_OK) != 0)
+        return -1;
+
+    int result = rename(filename, newFilename);
+    if (result != 0) 
+        return -1;
+
+    // move the sidecar index along with its log file
+    char index_filename[REGISTERED_THREAD_NAME_LEN_MAX + 4];
+    char new_index_filename[REGISTERED_THREAD_NAME_LEN_MAX + 4];
+    snprintf(index_filename, sizeof(index_filename), "%s.idx", filename);
+    snprintf(new_index_filename, sizeof(new_index_filename), "%s.idx", newFilename);
+    if (access(index_filename, F_OK) == 0)
+        rename(index_filename, new_index_filename);
+
+    pthread_mutex_lock(&LogLock);
+    Rename_Open_File(filename, newFilename);
+    Rename_Open_File(index_filename, new_index_filename);
+    pthread_mutex_unlock(&LogLock);
+
+    return 0;
+}
+
+// ------------------------------------------------------------------------------------------ Thread-Name Mapping ------------------------------------------------------------------------------------------
+
+//
+ThreadNameMap* add_Thread_Name_Mapping(pthread_t thread, const char* name) {
+
+    ThreadNameMap* loc_Found = f_find_Entry(thread);
+    if(loc_Found != NULL) {
+
+        //printf("  thread already has an Entry in [ThreadNameMap], [name] was updated");
+        strncpy(loc_Found->name, name, MIN(strlen(name), REGISTERED_THREAD_NAME_LEN_MAX));
+        return loc_Found;
+    }
+
+    ThreadNameMap* newEntry = (ThreadNameMap*) malloc(sizeof(ThreadNameMap));
+    if (newEntry == NULL) {
+        
+        printf("  Memory allocation failed\n");
+        return NULL;
+    }
+
+    memset(newEntry, 0, sizeof(ThreadNameMap));
+    strncpy(newEntry->name, name, MIN(strlen(name), REGISTERED_THREAD_NAME_LEN_MAX));
+    newEntry->thread_id = thread;
+    
+    if (firstEntry == NULL) {   // list is Empty
+
+        firstEntry = newEntry;
+        lastEntry = newEntry;
+    
+    } else {                      // Add to List-End
+
+        lastEntry->next = newEntry;
+        newEntry->prev = lastEntry;
+        lastEntry = newEntry;
+    }
+    
+    return newEntry;
+}
+
+// removes entry from linked list, if found
+void remove_Entry(pthread_t threadID) {
+
+    pthread_mutex_lock(&LogLock);
+    ThreadNameMap *locPointer = f_find_Entry(threadID);
+    if (locPointer == NULL)
+        return;
+    
+    if (firstEntry == lastEntry) {          // List has only one element
+
+        firstEntry = NULL;
+        lastEntry = NULL;
+    }
+
+    // List has more than one element
+    else {
+
+        if (locPointer == firstEntry){      // Is First?
+
+            firstEntry = firstEntry->next;
+            firstEntry->prev = NULL;
+        
+        } else if (locPointer == lastEntry) { // Is Last?
+
+            lastEntry = lastEntry->prev;
+            lastEntry->next = NULL;
+        
+        } else {                              // is in middle
+
+            locPointer->prev->next = locPointer->next;
+            locPointer->next->prev = locPointer->prev;
+        }
+    }
+
+    free(locPointer);
+    pthread_mutex_unlock(&LogLock);
+}
+
+// Iterate through list and try to find entry by thread // Returns NULL if not found
+ThreadNameMap* f_find_Entry(pthread_t threadID) {
+    
+    //printf("    f_find_Entry()  [thread: %lu]\n", threadID);
+    bool locFound = false;
+    ThreadNameMap *locPointer = firstEntry;
+    while (locFound == false && locPointer != NULL) {
+
+        //printf("    Iterating over Entry List current Entry.thread: %lu] [next: %s]\n", locPointer->thread_id, ptr_To_String(locPointer->next));
+
+        if (locPointer->thread_id == threadID)
+            locFound = true;
+        else
+            locPointer = locPointer->next;
+    }
+
+    return locFound ? locPointer : NULL;
+}
+
+// ------------------------------------------------------------------------------------------ Throttling ------------------------------------------------------------------------------------------
+
+// Emit "last message repeated N times" for the collapsed messages of the calling thread
+void Flush_Repeated_Message() {
+
+    Local_Repeat.valid = false;
+    if (Local_Repeat.repeated == 0)
+        return;
+
+    // copy the state first, the notice itself goes through log_output() and becomes the new last message
+    RepeatState repeat = Local_Repeat;
+    Local_Repeat.valid = false;
+    Local_Repeat.repeated = 0;
+    log_output(repeat.level, "", repeat.funcName, repeat.fileName, repeat.Line, repeat.thread_id, "last message repeated %" PRIu64 " times", repeat.repeated);
+}
+
+void Repeat_Thread_Exit(void* state) {
+
+    (void)state;
+    Flush_Repeated_Message();
+}
+
+void Repeat_Create_Key() {
+
+    pthread_key_create(&Repeat_Key, Repeat_Thread_Exit);
+}
+
+// Token bucket as GCRA: [tat_ns] is the theoretical arrival time of the next message, one CAS per allowed message
+// Returns 1 if the message should be logged, [suppressed] receives the number of messages dropped since the last one
+int log_rate_limit_allow(log_rate_limit* site, uint32_t per_second, uint32_t burst, uint64_t* suppressed) {
+
+    if (per_second == 0) {
+
+        __atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &spec);
+    uint64_t now = (uint64_t)spec.tv_sec * 1000000000ull + (uint64_t)spec.tv_nsec;
+    uint64_t interval = 1000000000ull / per_second;
+    uint64_t tolerance = interval * (burst > 0 ? burst - 1 : 0);
+
+    uint64_t tat = __atomic_load_n(&site->tat_ns, __ATOMIC_RELAXED);
+    uint64_t new_tat;
+    do {
+
+        uint64_t base = MAX(tat, now);
+        if (base - now > tolerance) {
+
+            __atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+        new_tat = base + interval;
+
+    } while (!__atomic_compare_exchange_n(&site->tat_ns, &tat, new_tat, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    *suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+    return 1;
+}
+
+//
+void set_Duplicate_Suppression(int enable) {
+
+    LogConfig* config = Config_Begin_Update();
+    if (config == NULL)
+        return;
+
+    config->suppress_duplicates = enable ? true : false;
+    Config_Publish(config);
+
+    // other threads flush their count with their next message
+    if (!enable)
+        Flush_Repeated_Message();
+}
+
+// ------------------------------------------------------------------------------------------ Runtime Configuration ------------------------------------------------------------------------------------------
+
+// All runtime configuration lives in an immutable LogConfig snapshot that is replaced with an atomic pointer swap.
+// Readers announce the global epoch they started in (Config_Acquire / Config_Release), a replaced snapshot is freed
+// once no reader that started before the swap is still active (epoch based reclamation). Updates are serialized by [Config_Lock].
+
+void Config_Reader_Exit(void* reader) {
+
+    atomic_store_explicit(&((ConfigReader*)reader)->epoch, 0, memory_order_release);
+    atomic_store_explicit(&((ConfigReader*)reader)->in_use, false, memory_order_release);
+
+    // other key destructors (Repeat_Thread_Exit) might still log, they have to get a slot of their own
+    Local_Config_Reader = NULL;
+}
+
+void Config_Create_Reader_Key() {
+
+    pthread_key_create(&Config_Reader_Key, Config_Reader_Exit);
+}
+
+// returns the reader slot of the calling thread, slots of finished threads are reused
+ConfigReader* Config_Get_Reader() {
+
+    if (Local_Config_Reader != NULL)
+        return Local_Config_Reader;
+
+    pthread_once(&Config_Reader_Key_Once, Config_Create_Reader_Key);
+    ConfigReader* reader = atomic_load_explicit(&Config_Readers, memory_order_acquire);
+    for (; reader != NULL; reader = reader->next) {
+
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&reader->in_use, &expected, true))
+            break;
+    }
+
+    if (reader == NULL) {
+
+        reader = calloc(1, sizeof(ConfigReader));
+        if (reader == NULL)
+            return NULL;
+
+        atomic_store_explicit(&reader->in_use, true, memory_order_relaxed);
+        reader->next = atomic_load_explicit(&Config_Readers, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak(&Config_Readers, &reader->next, reader));
+    }
+
+    pthread_setspecific(Config_Reader_Key, reader);
+    Local_Config_Reader = reader;
+    return reader;
+}
+
+// Returns the current snapshot, it stays valid until the matching Config_Release() (calls can be nested)
+const LogConfig* Config_Acquire() {
+
+    if (Local_Config_Depth++ == 0) {
+
+        ConfigReader* reader = Config_Get_Reader();
+        if (reader != NULL) {
+
+            atomic_store_explicit(&reader->epoch, atomic_load_explicit(&Config_Epoch, memory_order_relaxed), memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+        }
+    }
+    return atomic_load_explicit(&Current_Config, memory_order_acquire);
+}
+
+void Config_Release() {
+
+    if (--Local_Config_Depth == 0 && Local_Config_Reader != NULL)
+        atomic_store_explicit(&Local_Config_Reader->epoch, 0, memory_order_release);
+}
+
+char* Config_Copy_String(const char* text) {
+
+    return (text == NULL) ? NULL : strdup(text);
+}
+
+void Config_Free(LogConfig* config) {
+
+    if (config == &Default_Config)
+        return;
+
+    free(config->GeneralLogFormat);
+    free(config->GeneralLogFormat_BACKUP);
+    for (int x = 0; x < LL_MAX_NUM; x++)
+        free(config->SpecificLogFormat[x].Format);
+    free(config);
+}
+
+// Lock updates and return a private copy of the current snapshot, publish it with Config_Publish()
+LogConfig* Config_Begin_Update() {
+
+    pthread_mutex_lock(&Config_Lock);
+    const LogConfig* current = atomic_load_explicit(&Current_Config, memory_order_relaxed);
+    LogConfig* config = malloc(sizeof(LogConfig));
+    if (config == NULL) {
+
+        printf("  Memory allocation failed\n");
+        pthread_mutex_unlock(&Config_Lock);
+        return NULL;
+    }
+
+    *config = *current;
+    config->GeneralLogFormat = Config_Copy_String(current->GeneralLogFormat);
+    config->GeneralLogFormat_BACKUP = Config_Copy_String(current->GeneralLogFormat_BACKUP);
+    for (int x = 0; x < LL_MAX_NUM; x++)
+        config->SpecificLogFormat[x].Format = Config_Copy_String(current->SpecificLogFormat[x].Format);
+    config->version = current->version + 1;
+    return config;
+}
+
+// Swap in [config], retire the previous snapshot and free every retired snapshot no reader can still see
+void Config_Publish(LogConfig* config) {
+
+    LogConfig* previous = atomic_exchange_explicit(&Current_Config, config, memory_order_seq_cst);
+    previous->retire_epoch = atomic_fetch_add_explicit(&Config_Epoch, 1, memory_order_seq_cst);
+    previous->next_retired = Retired_Configs;
+    Retired_Configs = previous;
+
+    // oldest epoch any active reader started in
+    uint64_t oldest_reader = UINT64_MAX;
+    for (ConfigReader* reader = atomic_load_explicit(&Config_Readers, memory_order_acquire); reader != NULL; reader = reader->next) {
+
+        uint64_t epoch = atomic_load_explicit(&reader->epoch, memory_order_seq_cst);
+        if (epoch != 0)
+            oldest_reader = MIN(oldest_reader, epoch);
+    }
+
+    LogConfig** link = &Retired_Configs;
+    while (*link != NULL) {
+
+        LogConfig* retired = *link;
+        if (retired->retire_epoch < oldest_reader) {
+
+            *link = retired->next_retired;
+            Config_Free(retired);
+        }
+        else
+            link = &retired->next_retired;
+    }
+
+    pthread_mutex_unlock(&Config_Lock);
+}
+
+// ------------------------------------------------------------------------------------------ Formatting ------------------------------------------------------------------------------------------
+
+// Change Format of log messages and backup previous Format
+void set_Formatting(char* LogFormat) {
+
+    LogConfig* config = Config_Begin_Update();
+    if (config == NULL)
+        return;
+
+    free(config->GeneralLogFormat_BACKUP);
+    config->GeneralLogFormat_BACKUP = config->GeneralLogFormat;
+    config->GeneralLogFormat = Config_Copy_String(LogFormat);
+    Config_Publish(config);
+}
+
+// Sets the Backup version of Format to be used as Main Format
+void use_Formatting_Backup() {
+
+    LogConfig* config = Config_Begin_Update();
+    if (config == NULL)
+        return;
+
+    free(config->GeneralLogFormat);
+    config->GeneralLogFormat = Config_Copy_String(config->GeneralLogFormat_BACKUP);
+    Config_Publish(config);
+}
+
+//
+void Set_Format_For_Specific_Log_Level(enum log_level level, char* Format) {
+
+    LogConfig* config = Config_Begin_Update();
+    if (config == NULL)
+        return;
+
+    free(config->SpecificLogFormat[level].Format);
+    config->SpecificLogFormat[level].isInUse = true;
+    config->SpecificLogFormat[level].Format = Config_Copy_String(Format);
+    Config_Publish(config);
+}
+
+//
+void Disable_Format_For_Specific_Log_Level(enum log_level level) {
+
+    LogConfig* config = Config_Begin_Update();
+    if (config == NULL)
+        return;
+
+    config->SpecificLogFormat[level].isInUse = false;
+    Config_Publish(config);
+}
+
+// ------------------------------------------------------------------------------------------ Socket Sink ------------------------------------------------------------------------------------------
+
+// Sends flushed messages as framed records (cl_socket_frame + text) over a non-blocking Unix-domain socket.
+// Stream sockets get one sendmsg() per flush, datagram sockets one sendmmsg() with a datagram per record.
+// Whatever the socket does not take right now (collector down, socket buffer full) is spilled to the log files.
+// A stream frame that was only sent partially is finished first on the next flush to keep the framing intact.
+
+uint64_t Socket_Now_ns() {
+
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &spec);
+    return (uint64_t)spec.tv_sec * 1000000000ull + (uint64_t)spec.tv_nsec;
+}
+
+void Socket_Build_Frame(const message_plus_thread* message, cl_socket_frame* frame) {
+
+    memset(frame, 0, sizeof(*frame));
+    frame->length = (uint32_t)strlen(message->text);
+    frame->level = (uint32_t)message->level;
+    frame->sequence = message->sequence;
+    frame->time_ns = message->time_ns;
+    frame->thread = (uint64_t)message->thread;
+    frame->pid = (message->pid != 0) ? (int32_t)message->pid : Socket_Sink_pid;
+}
+
+// Returns true if connected, reconnects at most every CL_SOCKET_RETRY_NS
+bool Socket_Connect() {
+
+    if (Socket_Sink_fd >= 0)
+        return true;
+
+    uint64_t now = Socket_Now_ns();
+    if (now < Socket_Next_Connect_ns)
+        return false;
+    Socket_Next_Connect_ns = now + CL_SOCKET_RETRY_NS;
+
+    int fd = socket(AF_UNIX, (Socket_Sink_Datagram ? SOCK_DGRAM : SOCK_STREAM) | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", Socket_Sink_Path);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+
+        close(fd);
+        return false;
+    }
+
+    Socket_Sink_fd = fd;
+    Socket_Sink_pid = (int32_t)getpid();
+    return true;
+}
+
+void Socket_Close() {
+
+    if (Socket_Sink_fd >= 0)
+        close(Socket_Sink_fd);
+
+    Socket_Sink_fd = -1;
+    Socket_Next_Connect_ns = Socket_Now_ns() + CL_SOCKET_RETRY_NS;
+}
+
+// finish a partially sent stream frame, returns true if nothing is pending anymore
+bool Socket_Send_Pending() {
+
+    if (!Socket_Has_Pending)
+        return true;
+
+    cl_socket_frame frame;
+    Socket_Build_Frame(&Socket_Pending_Message, &frame);
+    char* parts[2] = { (char*)&frame, Socket_Pending_Message.text };
+    size_t lengths[2] = { sizeof(frame), frame.length };
+
+    struct iovec iov[2];
+    int iov_count = 0;
+    size_t skip = Socket_Pending_Sent;
+    for (int x = 0; x < 2; x++) {
+
+        if (skip >= lengths[x]) {
+            skip -= lengths[x];
+            continue;
+        }
+        iov[iov_count].iov_base = parts[x] + skip;
+        iov[iov_count].iov_len = lengths[x] - skip;
+        iov_count++;
+        skip = 0;
+    }
+
+    struct msghdr msg = { .msg_iov = iov, .msg_iovlen = (size_t)iov_count };
+    ssize_t result = sendmsg(Socket_Sink_fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (result < 0) {
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            Socket_Close();
+        return false;
+    }
+
+    Socket_Pending_Sent += (size_t)result;
+    if (Socket_Pending_Sent >= sizeof(frame) + frame.length)
+        Socket_Has_Pending = false;
+
+    return !Socket_Has_Pending;
+}
+
+// Send [messages], afterwards [messages] only contains the ones that still have to go to the log files
+int Socket_Send_Messages(const message_plus_thread** messages, int count) {
+
+    if (!Socket_Connect() || !Socket_Send_Pending()) {
+
+        // a frame the collector will never complete is written to the file instead
+        if (Socket_Sink_fd < 0 && Socket_Has_Pending) {
+
+            Socket_Has_Pending = false;
+            memmove(&messages[1], &messages[0], sizeof(messages[0]) * (size_t)count);
+            messages[0] = &Socket_Pending_Message;
+            count++;
+        }
+        return count;
+    }
+
+    cl_socket_frame frames[MAX_BUFFERED_MESSAGES + 1];
+    struct iovec iov[2 * (MAX_BUFFERED_MESSAGES + 1)];
+    for (int x = 0; x < count; x++) {
+
+        Socket_Build_Frame(messages[x], &frames[x]);
+        iov[2 * x].iov_base = &frames[x];
+        iov[2 * x].iov_len = sizeof(frames[x]);
+        iov[2 * x + 1].iov_base = (void*)messages[x]->text;
+        iov[2 * x + 1].iov_len = frames[x].length;
+    }
+
+    int sent = 0;
+    if (Socket_Sink_Datagram) {
+
+        struct mmsghdr datagrams[MAX_BUFFERED_MESSAGES + 1];
+        memset(datagrams, 0, sizeof(datagrams));
+        for (int x = 0; x < count; x++) {
+
+            datagrams[x].msg_hdr.msg_iov = &iov[2 * x];
+            datagrams[x].msg_hdr.msg_iovlen = 2;
+        }
+
+        int result = sendmmsg(Socket_Sink_fd, datagrams, (unsigned int)count, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            Socket_Close();
+        sent = MAX(result, 0);
+    }
+
+    else {
+
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = (size_t)(2 * count) };
+        ssize_t result = sendmsg(Socket_Sink_fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (result < 0) {
+
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                Socket_Close();
+            result = 0;
+        }
+
+        // count complete frames, a partially sent frame becomes pending
+        size_t remaining = (size_t)result;
+        while (sent < count && remaining >= sizeof(frames[sent]) + frames[sent].length) {
+
+            remaining -= sizeof(frames[sent]) + frames[sent].length;
+            sent++;
+        }
+        if (remaining > 0) {
+
+            Socket_Pending_Message = *messages[sent];
+            Socket_Pending_Sent = remaining;
+            Socket_Has_Pending = true;
+            sent++;
+        }
+    }
+
+    memmove(&messages[0], &messages[sent], sizeof(messages[0]) * (size_t)(count - sent));
+    return count - sent;
+}
+
+// Send all following messages to the Unix-domain socket [socket_path] (stream or datagram)
+// Returns -1 if [socket_path] is invalid, a collector that is not up yet is retried on later flushes
+int log_connect_socket_sink(const char* socket_path, int use_datagram) {
+
+    if (socket_path == NULL || strlen(socket_path) >= sizeof(Socket_Sink_Path))
+        return -1;
+
+    log_disconnect_socket_sink();
+    pthread_mutex_lock(&LogLock);
+    snprintf(Socket_Sink_Path, sizeof(Socket_Sink_Path), "%s", socket_path);
+    Socket_Sink_Datagram = use_datagram ? true : false;
+    Socket_Next_Connect_ns = 0;
+    Socket_Connect();
+    pthread_mutex_unlock(&LogLock);
+    return 0;
+}
+
+// Stop sending to the socket, a partially sent frame is written to the log file
+void log_disconnect_socket_sink() {
+
+    pthread_mutex_lock(&LogLock);
+    if (Socket_Sink_Path[0] != '\0') {
+
+        if (Socket_Sink_fd >= 0)
+            Socket_Send_Pending();
+        Socket_Close();
+
+        if (Socket_Has_Pending) {
+
+            const message_plus_thread* pending = &Socket_Pending_Message;
+            Socket_Has_Pending = false;
+            Write_Messages_To_Files(&pending, 1);
+        }
+        Socket_Sink_Path[0] = '\0';
+    }
+    pthread_mutex_unlock(&LogLock);
+}
+
+// ------------------------------------------------------------------------------------------ Shared Memory ------------------------------------------------------------------------------------------
+
+// Bounded lock-free MPMC ring (Vyukov) in a POSIX shared-memory segment, producers of all processes publish into it and
+// one collector drains it. Whoever comes first creates and initializes the segment, everybody else waits until it is ready.
+// If the ring is full a message is dropped and counted instead of blocking the producer.
+// A producer that dies between claiming a slot and publishing it would block the ring for good, the collector skips
+// such a slot (see Shared_Ring_Skip_Dead_Slot) and counts it as dropped.
+
+// [repair] (collector only): a segment whose creator died before sizing or initializing it is initialized again,
+// otherwise such a segment is refused
+SharedRing* Shared_Ring_Attach(const char* shm_name, bool repair) {
+
+    bool created = true;
+    int fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0666);
+    if (fd < 0 && errno == EEXIST) {
+
+        created = false;
+        fd = shm_open(shm_name, O_RDWR, 0666);
+    }
+    if (fd < 0) {
+
+        perror("Error opening shared memory");
+        return NULL;
+    }
+
+    if (created && ftruncate(fd, sizeof(SharedRing)) != 0) {
+
+        perror("Error sizing shared memory");
+        close(fd);
+        shm_unlink(shm_name);
+        return NULL;
+    }
+
+    // the creator might not have sized the segment yet
+    struct stat st;
+    for (int x = 0; x < 1000 && fstat(fd, &st) == 0 && st.st_size == 0; x++)
+        usleep(1000);
+
+    if (fstat(fd, &st) != 0 || (st.st_size == 0 && (!repair || ftruncate(fd, sizeof(SharedRing)) != 0))) {
+
+        fprintf(stderr, "Shared memory [%s] was never sized (its creator died?), remove it or start the collector\n", shm_name);
+        close(fd);
+        return NULL;
+    }
+    if (st.st_size == 0)
+        created = true;     // repaired, initialize it below
+    else if ((size_t)st.st_size != sizeof(SharedRing)) {
+
+        fprintf(stderr, "Shared memory [%s] has a different layout (%lld bytes, expected %zu), it belongs to another build\n", shm_name, (long long)st.st_size, sizeof(SharedRing));
+        close(fd);
+        return NULL;
+    }
+
+    SharedRing* ring = mmap(NULL, sizeof(SharedRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) {
+
+        perror("Error mapping shared memory");
+        return NULL;
+    }
+
+    if (!created) {
+
+        for (int x = 0; x < 1000 && atomic_load_explicit(&ring->ready, memory_order_acquire) == 0; x++)
+            usleep(1000);
+
+        uint64_t ready = atomic_load_explicit(&ring->ready, memory_order_acquire);
+        if (ready == CL_SHM_READY)
+            return ring;
+
+        if (ready != 0 || !repair) {
+
+            fprintf(stderr, "Shared memory [%s] %s\n", shm_name, (ready != 0) ? "has a different layout, it belongs to another build" : "was never initialized");
+            munmap(ring, sizeof(SharedRing));
+            return NULL;
+        }
+    }
+
+    for (uint64_t x = 0; x < CL_SHM_RING_SLOTS; x++) {
+
+        atomic_store_explicit(&ring->slots[x].turn, x, memory_order_relaxed);
+        atomic_store_explicit(&ring->slots[x].pid, 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&ring->enqueue_pos, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->dequeue_pos, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->sequence, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->dropped, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->ready, CL_SHM_READY, memory_order_release);
+    return ring;
+}
+
+// Returns false if the ring is full (the message is dropped)
+bool Shared_Ring_Publish(SharedRing* ring, enum log_level level, const char* message, pthread_t threadID, uint64_t sequence, uint64_t time_ns) {
+
+    SharedRingSlot* slot;
+    uint64_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    while (true) {
+
+        slot = &ring->slots[pos & (CL_SHM_RING_SLOTS - 1)];
+        int64_t diff = (int64_t)atomic_load_explicit(&slot->turn, memory_order_acquire) - (int64_t)pos;
+        if (diff == 0) {
+
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0) {
+
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return false;
+        }
+        else
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&slot->pid, (int32_t)getpid(), memory_order_relaxed);
+    slot->sequence = sequence;
+    slot->time_ns = time_ns;
+    slot->thread = (uint64_t)threadID;
+    slot->level = (int32_t)level;
+    snprintf(slot->text, sizeof(slot->text), "%s", message);
+
+    // fails if the collector gave up on this slot in the meantime (it already counted the message as dropped)
+    uint64_t expected = pos;
+    return atomic_compare_exchange_strong_explicit(&slot->turn, &expected, pos + 1, memory_order_release, memory_order_relaxed);
+}
+
+// Moves one message from the ring into the local buffer, returns false if the ring is empty
+bool Shared_Ring_Collect(SharedRing* ring) {
+
+    SharedRingSlot* slot;
+    uint64_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    while (true) {
+
+        slot = &ring->slots[pos & (CL_SHM_RING_SLOTS - 1)];
+        int64_t diff = (int64_t)atomic_load_explicit(&slot->turn, memory_order_acquire) - (int64_t)(pos + 1);
+        if (diff == 0) {
+
+            if (atomic_compare_exchange_weak_explicit(&ring->dequeue_pos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return false;
+        else
+            pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    }
+
+    Store_Message((enum log_level)slot->level, slot->text, (pthread_t)slot->thread, atomic_load_explicit(&slot->pid, memory_order_relaxed), slot->sequence, slot->time_ns, false);
+    atomic_store_explicit(&slot->pid, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->turn, pos + CL_SHM_RING_SLOTS, memory_order_release);
+    return true;
+}
+
+// Called when the ring looks empty: if the next slot was claimed but is not published for too long, skip it.
+// [stuck_pos] / [stuck_since_ns] remember since when the collector waits for the slot. Returns true if a slot was skipped.
+bool Shared_Ring_Skip_Dead_Slot(SharedRing* ring, uint64_t* stuck_pos, uint64_t* stuck_since_ns) {
+
+    uint64_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    SharedRingSlot* slot = &ring->slots[pos & (CL_SHM_RING_SLOTS - 1)];
+    if (atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed) == pos || atomic_load_explicit(&slot->turn, memory_order_acquire) != pos) {
+
+        *stuck_pos = UINT64_MAX;
+        return false;
+    }
+
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &spec);
+    uint64_t now = (uint64_t)spec.tv_sec * 1000000000ull + (uint64_t)spec.tv_nsec;
+    if (*stuck_pos != pos) {
+
+        *stuck_pos = pos;
+        *stuck_since_ns = now;
+        return false;
+    }
+
+    // the pid is only set shortly after the slot was claimed, without it only the long timeout applies
+    uint64_t waiting = now - *stuck_since_ns;
+    pid_t owner = (pid_t)atomic_load_explicit(&slot->pid, memory_order_relaxed);
+    bool owner_dead = owner != 0 && kill(owner, 0) != 0 && errno != EPERM;
+    if (waiting < CL_SHM_DEAD_SLOT_NS || (!owner_dead && waiting < CL_SHM_STUCK_SLOT_NS))
+        return false;
+
+    // the producer might publish right now, only one of us wins
+    uint64_t expected = pos;
+    if (!atomic_compare_exchange_strong_explicit(&slot->turn, &expected, pos + CL_SHM_RING_SLOTS, memory_order_acq_rel, memory_order_acquire))
+        return true;
+
+    atomic_store_explicit(&slot->pid, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->dequeue_pos, pos + 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+    *stuck_pos = UINT64_MAX;
+    return true;
+}
+
+// A collector that died between taking a message and releasing its slot leaves the slot blocked, release it
+void Shared_Ring_Repair(SharedRing* ring) {
+
+    uint64_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    if (pos == 0)
+        return;
+
+    SharedRingSlot* slot = &ring->slots[(pos - 1) & (CL_SHM_RING_SLOTS - 1)];
+    uint64_t expected = pos;
+    if (atomic_compare_exchange_strong_explicit(&slot->turn, &expected, pos - 1 + CL_SHM_RING_SLOTS, memory_order_acq_rel, memory_order_relaxed)) {
+
+        atomic_store_explicit(&slot->pid, 0, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+    }
+}
+
+// Collector thread: drain the ring, sleep shortly when it is empty
+// Collected messages are not flushed one by one (that would cost an I/O batch per message and let the ring overflow),
+// the buffer is written when it is full and at the end of every drain pass, i.e. as soon as the ring is idle
+void* Shared_Collector_Thread(void* arg) {
+
+    (void)arg;
+    uint64_t reported_drops = 0;
+    uint64_t stuck_pos = UINT64_MAX;
+    uint64_t stuck_since_ns = 0;
+    while (true) {
+
+        bool stop = atomic_load_explicit(&Shared_Collector_Stop, memory_order_acquire);
+        int collected = 0;
+        while (Shared_Ring_Collect(Shared_Ring))
+            collected++;
+
+        if (collected > 0)
+            Flush_Message_Buffer();
+
+        if (collected == 0 && Shared_Ring_Skip_Dead_Slot(Shared_Ring, &stuck_pos, &stuck_since_ns))
+            collected++;
+
+        uint64_t dropped = atomic_load_explicit(&Shared_Ring->dropped, memory_order_relaxed);
+        if (dropped != reported_drops) {
+
+            CL_LOG(Warn, "Shared log ring dropped %" PRIu64 " messages (ring full or producer died)", dropped - reported_drops)
+            reported_drops = dropped;
+        }
+
+        if (stop)
+            return NULL;
+
+        if (collected == 0)
+            usleep(CL_SHM_COLLECTOR_IDLE_US);
+    }
+}
+
+// Attach to the shared ring [shm_name] as producer, this process will not touch the log directory
+int log_init_shared_producer(const char* shm_name, char* GeneralLogFormat) {
+
+    LogConfig* config = Config_Begin_Update();
+    if (config != NULL) {
+
+        free(config->GeneralLogFormat);
+        config->GeneralLogFormat = Config_Copy_String(GeneralLogFormat);
+        Config_Publish(config);
+    }
+
+    SharedRing* ring = Shared_Ring_Attach(shm_name, false);
+    if (ring == NULL)
+        return -1;
+
+    Shared_Ring = ring;
+    Shared_Is_Producer = true;
+    return 0;
+}
+
+// Drain the shared ring [shm_name] into the log files of this process on a background thread (call after log_init())
+int log_start_shared_collector(const char* shm_name) {
+
+    if (Shared_Ring != NULL)
+        return -1;
+
+    SharedRing* ring = Shared_Ring_Attach(shm_name, true);
+    if (ring == NULL)
+        return -1;
+
+    Shared_Ring_Repair(ring);
+    Shared_Ring = ring;
+    atomic_store_explicit(&Shared_Collector_Stop, false, memory_order_relaxed);
+    if (pthread_create(&Shared_Collector, NULL, Shared_Collector_Thread, NULL) != 0) {
+
+        Shared_Ring = NULL;
+        munmap(ring, sizeof(SharedRing));
+        return -1;
+    }
+
+    Shared_Collector_Running = true;
+    CL_LOG(Trace, "Collecting shared log messages from [%s]", shm_name)
+    return 0;
+}
+
+// stop the collector thread (after draining the ring) or detach the producer
+void Shared_Ring_Detach() {
+
+    if (Shared_Ring == NULL)
+        return;
+
+    if (Shared_Collector_Running) {
+
+        atomic_store_explicit(&Shared_Collector_Stop, true, memory_order_release);
+        pthread_join(Shared_Collector, NULL);
+        Shared_Collector_Running = false;
+    }
+
+    // the mapping is kept, other threads of this process might still be publishing
+    Shared_Ring = NULL;
+    Shared_Is_Producer = false;
+}
+
+// ------------------------------------------------------------------------------------------ Misc ------------------------------------------------------------------------------------------
+
+// get system time
+struct tm getLocalTime(void) {
+
+    time_t t = time(NULL);
+    struct tm tm = *localtime(&t);
+    return tm;
+}
+
+//
+void set_buffer_Level(int newLevel) {
+
+    if( newLevel <= 4 && newLevel >= 0) {
+
+        LogConfig* config = Config_Begin_Update();
+        if (config == NULL)
+            return;
+
+        config->log_level_for_buffer = newLevel;
+        Config_Publish(config);
+    }
+
+    else 
+        CL_LOG(Error, "Input invalid Level (0 <= newLevel <= 4), input: %d", newLevel)
+}
+
+// Set what leg level should be printed to terminal
+// CAUTION! this only applies to log levels that are enabled be LOG_LEVEL_ENABLED
+void set_log_level(enum log_level new_level) {
+
+    CL_VALIDATE(new_level < LL_MAX_NUM && new_level > Fatal, "", "Selected log level is out of bounds (1 <= [new_level: %d] <= 5)", return, new_level)
+
+    CL_LOG(Trace, "Setting [log_level: %s]", level_str[new_level])
+    LogConfig* config = Config_Begin_Update();
+    if (config == NULL)
+        return;
+
+    config->internal_level = new_level;
+    Config_Publish(config);
+}
+
+//
+int remove_all_Files_In_Directory(const char *dirName) {
+
+    DIR *dir = opendir(dirName);
+    if (dir == NULL) {
+        perror("Error opening directory");
+        return -1;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+
+        if (entry->d_type == DT_REG) {
+        
+            // It's a regular file, remove it
+            char filepath[REGISTERED_THREAD_NAME_LEN_MAX *2];
+            snprintf(filepath, sizeof(filepath), "%s/%s", dirName, entry->d_name);
+
+            if (remove(filepath) != 0) {
+                perror("Error removing file");
+                closedir(dir);
+                return -1;
+            }
+        }
+    }
+
+    closedir(dir);
+    return 0;
+}
+
+// ------------------------------------------------------------------------------------------ Log Directory ------------------------------------------------------------------------------------------
+
+// Every run logs into its own directory [<root>/<yyyymmdd-hhmmss>_<pid>], [<root>/latest] points to the current one.
+// Old runs are pruned by a background thread after log_init() according to the retention policy.
+
+// Change the root directory of all log files (call before log_init())
+void set_Log_Root(const char* root) {
+
+    if (root != NULL && root[0] != '\0')
+        snprintf(Log_Root, sizeof(Log_Root), "%s", root);
+}
+
+// Use a separate directory for every run (default) or write into the root directory and empty it on log_init() (call before log_init())
+void set_Log_Run_Directories(int enable) {
+
+    Use_Run_Directories = enable ? true : false;
+}
+
+// Keep at most [max_runs] runs, no run older than [max_age_seconds] and at most [max_total_bytes] in the root directory (0 = no limit)
+void set_Log_Retention(int max_runs, int max_age_seconds, uint64_t max_total_bytes) {
+
+    Retention_Max_Runs = MAX(max_runs, 0);
+    Retention_Max_Age_s = MAX(max_age_seconds, 0);
+    Retention_Max_Bytes = max_total_bytes;
+}
+
+// Create [path] and all missing parent directories
+int Create_Directories(const char* path) {
+
+    char buffer[sizeof(Log_Root)];
+    snprintf(buffer, sizeof(buffer), "%s", path);
+    for (char* pos = buffer + 1; *pos != '\0'; pos++) {
+
+        if (*pos != '/')
+            continue;
+
+        *pos = '\0';
+        if (mkdir(buffer, 0777) != 0 && errno != EEXIST)
+            return -1;
+        *pos = '/';
+    }
+
+    if (mkdir(buffer, 0777) != 0 && errno != EEXIST)
+        return -1;
+    return 0;
+}
+
+// Set [directoryName] to a new run directory below [Log_Root] (or the root itself) and create it
+int Setup_Log_Directory() {
+
+    if (Create_Directories(Log_Root) != 0) {
+
+        perror("Error creating log root");
+        return -1;
+    }
+
+    if (!Use_Run_Directories) {
+
+        snprintf(directoryName, sizeof(directoryName), "%s", Log_Root);
+        if (remove_all_Files_In_Directory(directoryName) != 0) 
+            fprintf(stderr, "Error removing files in the directory.\n");
+        return 0;
+    }
+
+    struct tm tm = getLocalTime();
+    snprintf(Current_Run_Name, sizeof(Current_Run_Name), "%04d%02d%02d-%02d%02d%02d_%d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, (int)getpid());
+    snprintf(directoryName, sizeof(directoryName), "%s/%s", Log_Root, Current_Run_Name);
+    if (mkdir(directoryName, 0777) != 0 && errno != EEXIST) {
+
+        perror("Error creating run directory");
+        return -1;
+    }
+    Lock_Log_Run();
+
+    // relative link, stays valid if the root is moved
+    char latest[sizeof(Log_Root) + 8];
+    snprintf(latest, sizeof(latest), "%s/latest", Log_Root);
+    unlink(latest);
+    if (symlink(Current_Run_Name, latest) != 0)
+        perror("Error linking latest run");
+
+    if (Retention_Max_Runs > 0 || Retention_Max_Age_s > 0 || Retention_Max_Bytes > 0) {
+
+        pthread_t pruner;
+        if (pthread_create(&pruner, NULL, Prune_Log_Runs, NULL) == 0)
+            pthread_detach(pruner);
+    }
+    return 0;
+}
+
+// Hold an exclusive flock() on the lock file of the current run until shutdown, pruners of other processes test it.
+// Unlike the pid in the directory name this is not fooled by reused pids (e.g. a restarted container is pid 1 again)
+void Lock_Log_Run() {
+
+    if (Run_Lock_fd >= 0)
+        close(Run_Lock_fd);
+
+    char path[sizeof(directoryName) + sizeof(CL_RUN_LOCK_NAME) + 1];
+    snprintf(path, sizeof(path), "%s/%s", directoryName, CL_RUN_LOCK_NAME);
+    Run_Lock_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (Run_Lock_fd < 0 || flock(Run_Lock_fd, LOCK_EX | LOCK_NB) != 0)
+        perror("Error locking run directory");
+}
+
+// [name] looks like a run directory created by Setup_Log_Directory()
+bool Is_Run_Directory_Name(const char* name) {
+
+    size_t length = strlen(name);
+    if (length < 17 || length >= sizeof(((LogRun*)0)->name) || name[8] != '-' || name[15] != '_')
+        return false;
+
+    for (int x = 0; name[x] != '\0'; x++)
+        if (x != 8 && x != 15 && (name[x] < '0' || name[x] > '9'))
+            return false;
+    return true;
+}
+
+// the lock file of a run is still locked by the process that created it (the lock is released when that process exits)
+// A run without lock file was just created or written by an older version, fall back to its [_<pid>] suffix
+bool Is_Run_Alive(const char* name) {
+
+    char path[sizeof(Log_Root) + 64 + sizeof(CL_RUN_LOCK_NAME) + 1];
+    snprintf(path, sizeof(path), "%s/%s/%s", Log_Root, name, CL_RUN_LOCK_NAME);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+
+        bool locked = flock(fd, LOCK_SH | LOCK_NB) != 0 && errno == EWOULDBLOCK;
+        close(fd);
+        return locked;
+    }
+
+    pid_t pid = (pid_t)strtol(name + 16, NULL, 10);
+    if (pid <= 0)
+        return false;
+
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+int Compare_Log_Runs(const void* a, const void* b) {
+
+    return strcmp(((const LogRun*)a)->name, ((const LogRun*)b)->name);
+}
+
+// Sum the file sizes of a run and find its last write
+void Scan_Log_Run(const char* path, LogRun* run) {
+
+    run->bytes = 0;
+    run->last_write = 0;
+    DIR* dir = opendir(path);
+    if (dir == NULL)
+        return;
+
+    struct dirent* entry;
+    char filepath[sizeof(Log_Root) + REGISTERED_THREAD_NAME_LEN_MAX * 2];
+    while ((entry = readdir(dir)) != NULL) {
+
+        struct stat st;
+        snprintf(filepath, sizeof(filepath), "%s/%s", path, entry->d_name);
+        if (entry->d_type != DT_DIR && strcmp(entry->d_name, CL_RUN_LOCK_NAME) != 0 && stat(filepath, &st) == 0) {
+
+            run->bytes += (uint64_t)st.st_size;
+            run->last_write = MAX(run->last_write, st.st_mtime);
+        }
+    }
+    closedir(dir);
+}
+
+// Background thread: delete the oldest runs until the retention policy is met
+// Runs of processes that are still running (including this one) are never deleted, they still count towards the limits
+void* Prune_Log_Runs(void* arg) {
+
+    (void)arg;
+    DIR* dir = opendir(Log_Root);
+    if (dir == NULL)
+        return NULL;
+
+    LogRun* runs = NULL;
+    int run_count = 0;
+    int run_capacity = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+
+        if (!Is_Run_Directory_Name(entry->d_name) || strcmp(entry->d_name, Current_Run_Name) == 0)
+            continue;
+
+        if (run_count >= run_capacity) {
+
+            run_capacity = MAX(16, run_capacity * 2);
+            LogRun* new_runs = realloc(runs, sizeof(LogRun) * (size_t)run_capacity);
+            if (new_runs == NULL)
+                break;
+            runs = new_runs;
+        }
+        snprintf(runs[run_count].name, sizeof(runs[run_count].name), "%.63s", entry->d_name);
+        runs[run_count].alive = Is_Run_Alive(entry->d_name);
+        run_count++;
+    }
+    closedir(dir);
+    if (run_count == 0) {
+
+        free(runs);
+        return NULL;
+    }
+
+    // directory names start with the start time, oldest first
+    qsort(runs, (size_t)run_count, sizeof(LogRun), Compare_Log_Runs);
+    uint64_t total_bytes = 0;
+    char path[sizeof(Log_Root) + REGISTERED_THREAD_NAME_LEN_MAX];
+    for (int x = 0; x < run_count; x++) {
+
+        snprintf(path, sizeof(path), "%s/%s", Log_Root, runs[x].name);
+        Scan_Log_Run(path, &runs[x]);
+        total_bytes += runs[x].bytes;
+    }
+
+    time_t now = time(NULL);
+    int remaining_runs = run_count + 1;
+    for (int x = 0; x < run_count; x++) {
+
+        if (runs[x].alive)
+            continue;
+
+        // a run without files has not written anything yet, it is new and not expired
+        bool too_many = Retention_Max_Runs > 0 && remaining_runs > Retention_Max_Runs;
+        bool too_old = Retention_Max_Age_s > 0 && runs[x].last_write != 0 && now - runs[x].last_write > Retention_Max_Age_s;
+        bool too_big = Retention_Max_Bytes > 0 && total_bytes > Retention_Max_Bytes;
+        if (!too_many && !too_old && !too_big)
+            continue;
+
+        snprintf(path, sizeof(path), "%s/%s", Log_Root, runs[x].name);
+        if (remove_all_Files_In_Directory(path) == 0 && rmdir(path) == 0) {
+
+            remaining_runs--;
+            total_bytes -= runs[x].bytes;
+        }
+    }
+
+    free(runs);
+    return NULL;
 }
 
 // ------------------------------------------------------------------------------------------ Measure Time ------------------------------------------------------------------------------------------
@@ -3,6 +3,7 @@
 #include <time.h>
 #include <pthread.h>
 #include <errno.h>
+#include <inttypes.h>
 
 // This enables the compilation of various logging levels (FATAL & ERROR are always on)
 //  0    =>   FATAL + ERROR
@@ -65,7 +66,9 @@ void Calc_Func_Duration(struct log_time_exact* StartTime);
     $B		Color Begin			from here the color starts
     $E		Color End			from here the color ends
     $C		Text				Formatted Message with variables
-    $Z		New Line			Adds a new Line to the log*/
+    $Z		New Line			Adds a new Line to the log
+    
+    Format strings are copied, configuration changes are safe to make at runtime from any thread*/
 void set_Formatting(char* format);
 void use_Formatting_Backup();
 void Set_Format_For_Specific_Log_Level(enum log_level level, char* Format);
@@ -80,6 +83,85 @@ void Disable_Format_For_Specific_Log_Level(enum log_level level);
 void set_buffer_Level(int newLevel);
 
 
+// ------------------------------------------------------------------------------ Log Directory ------------------------------------------------------------------------------
+
+/*  log_init() writes into a new directory for every run: [<root>/<yyyymmdd-hhmmss>_<pid>], [<root>/latest] links to it
+    Old runs are pruned on a background thread after startup (default: keep the last 10 runs),
+    runs whose process is still running (it holds [<run>/.lock]) are never pruned
+    call these before log_init()*/
+void set_Log_Root(const char* root);                                                        // default: "./logs"
+void set_Log_Run_Directories(int enable);                                                   // 0 = old behavior: write into root and delete all files in it
+void set_Log_Retention(int max_runs, int max_age_seconds, uint64_t max_total_bytes);       // 0 = no limit
+
+// ------------------------------------------------------------------------------ Multi-Process Logging ------------------------------------------------------------------------------
+
+/*  Several processes can share one set of log files through a shared-memory ring [shm_name] (e.g. "/cl_log")
+    - producers call log_init_shared_producer() INSTEAD of log_init(), they never touch the log directory
+    - one collector calls log_init() and then log_start_shared_collector(), it owns the files (see tools/cl_collector.c)
+    In per-thread mode messages of other processes go to [process_<pid>_thread_log_<thread>.log]
+    If the ring is full messages are dropped (the collector reports how many), producers never block
+    A message of a producer that was killed while publishing it is skipped by the collector and counted as dropped
+    Producers refuse (return -1) a segment of another build or one its creator never finished, the collector re-initializes the latter*/
+int log_init_shared_producer(const char* shm_name, char* GeneralLogFormat);
+int log_start_shared_collector(const char* shm_name);
+
+// ------------------------------------------------------------------------------ Socket Sink ------------------------------------------------------------------------------
+
+/*  Deliver flushed messages to a local collector over a Unix-domain socket instead of the log files
+    Every record is a cl_socket_frame (host byte order) followed by [length] bytes of formatted text.
+    Stream sockets carry a sequence of records, datagram sockets one record per datagram.
+    The socket never blocks the caller, messages are spilled to the log files while the collector is down or busy
+    and the connection is retried on later flushes. See tools/cl_receiver.c for a minimal receiver.*/
+typedef struct cl_socket_frame {
+    uint32_t length;                // bytes of text following the frame header
+    uint32_t level;                 // enum log_level
+    uint64_t sequence;
+    uint64_t time_ns;
+    uint64_t thread;
+    int32_t pid;
+    uint32_t reserved;
+} cl_socket_frame;
+
+int log_connect_socket_sink(const char* socket_path, int use_datagram);
+void log_disconnect_socket_sink();
+
+// ------------------------------------------------------------------------------ Record Stamps ------------------------------------------------------------------------------
+
+/*  Every message gets a global sequence number and a nanosecond timestamp when it is enqueued.
+    If [Use_separate_Files_for_every_Thread] or the sidecar index is enabled every record in the log files starts with this stamp:
+    
+    @<sequence>  <time>               <level> <message>
+    @000000000000002a 1729350000123456789 3 [INFO ] ...
+
+    sequence    16 hex digits, global over all threads
+    time        19 digits, nanoseconds since epoch (CLOCK_REALTIME)
+    level       1 digit, enum log_level
+
+    use tools/cl_merge.c (cl-merge) to merge the per-thread files back into one ordered stream*/
+#define CL_RECORD_STAMP_MARKER      '@'
+#define CL_RECORD_STAMP_FORMAT      "@%016" PRIx64 " %019" PRIu64 " %1u "
+#define CL_RECORD_STAMP_LEN         40
+
+/*  Sidecar index: when enabled every log file gets a compact block index [<log file>.idx]
+    Consecutive flushes are merged into one block, an entry is written once a block reaches 64 KiB or spans 1 s,
+    before a FATAL message and on log_shutdown(). Records behind the last entry are not indexed yet.
+    The index file starts with CL_INDEX_MAGIC followed by cl_index_entry records (host byte order).
+    use tools/cl_query.c (cl-query) to answer time-range / level / substring queries with it*/
+#define CL_INDEX_MAGIC              "CLIDX001"
+#define CL_INDEX_MAGIC_LEN          8
+
+typedef struct cl_index_entry {
+    uint64_t offset;                // byte offset of the block in the log file
+    uint64_t length;                // byte length of the block
+    uint64_t time_first_ns;         // enqueue time of the first record in the block
+    uint64_t time_last_ns;          // enqueue time of the last record in the block
+    uint32_t level_mask;            // (1 << log_level) for every level present in the block
+    uint32_t count;                 // number of records in the block
+} cl_index_entry;
+
+// Enable/disable writing the sidecar index [<log file>.idx] (disabled by default)
+void set_File_Index(int enable);
+
 // ------------------------------------------------------------------------------ Helper Functions ------------------------------------------------------------------------------
 
 // checks pointers and returns " NULL" or "valid"
@@ -160,6 +242,47 @@ static inline const char* ptr_To_String(void* pointer) { return (pointer == NULL
 
 #define CL_LOG(Type, message, ...)                  CL_LOG_##Type(message, ##__VA_ARGS__)
 
+// ------------------------------------------------------------------------------ THROTTLING ------------------------------------------------------------------------------
+
+// Per-call-site throttling, the decision is made with one atomic operation before any formatting happens
+typedef struct log_rate_limit {
+    uint64_t tat_ns;
+    uint64_t suppressed;
+} log_rate_limit;
+
+int log_rate_limit_allow(log_rate_limit* site, uint32_t per_second, uint32_t burst, uint64_t* suppressed);
+
+// Collapse consecutive identical messages of a thread into "last message repeated N times" (disabled by default)
+// The count is written with the next different message of the thread, every second while the repetition goes on,
+// when the thread exits and when suppression is disabled (other threads: with their next message)
+void set_Duplicate_Suppression(int enable);
+
+// Log only every [N]th call of this call site (the 1st, N+1st, ...), [N] <= 0 disables the call site, [N] is evaluated once
+#define CL_LOG_EVERY_N(Type, N, message, ...)       do{ static uint64_t cl_site_counter = 0;                                                    \
+                                                        int64_t cl_site_n = (int64_t)(N);                                                       \
+                                                        if (cl_site_n > 0 && __atomic_fetch_add(&cl_site_counter, 1, __ATOMIC_RELAXED) % (uint64_t)cl_site_n == 0) \
+                                                            CL_LOG(Type, message, ##__VA_ARGS__)                                                \
+                                                    } while(0);
+
+// Log only the first [N] calls of this call site, [N] <= 0 disables the call site, [N] is evaluated once
+#define CL_LOG_FIRST_N(Type, N, message, ...)       do{ static uint64_t cl_site_counter = 0;                                                    \
+                                                        int64_t cl_site_n = (int64_t)(N);                                                       \
+                                                        if (cl_site_n > 0 && __atomic_load_n(&cl_site_counter, __ATOMIC_RELAXED) < (uint64_t)cl_site_n \
+                                                            && __atomic_fetch_add(&cl_site_counter, 1, __ATOMIC_RELAXED) < (uint64_t)cl_site_n) \
+                                                            CL_LOG(Type, message, ##__VA_ARGS__)                                                \
+                                                    } while(0);
+
+// Log at most [per_second] messages per second from this call site, allowing bursts of [burst] messages
+#define CL_LOG_RATE_LIMITED(Type, per_second, burst, message, ...)                                                                              \
+                                                    do{ static log_rate_limit cl_site_limit = { 0, 0 };                                         \
+                                                        uint64_t cl_site_suppressed = 0;                                                        \
+                                                        if (log_rate_limit_allow(&cl_site_limit, per_second, burst, &cl_site_suppressed)) {     \
+                                                            if (cl_site_suppressed > 0)                                                         \
+                                                                CL_LOG(Type, "suppressed %" PRIu64 " messages of this call site", cl_site_suppressed) \
+                                                            CL_LOG(Type, message, ##__VA_ARGS__)                                                \
+                                                        }                                                                                       \
+                                                    } while(0);
+
 // ------------------------------------------------------------------------------ VALIDATION / ASSERTION ------------------------------------------------------------------------------
 #define CL_VALIDATE(expr, messageSuccess, messageFailure, abortCommand, ...)                \
         if (expr) {                                                                         \
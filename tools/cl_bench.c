@@ -0,0 +1,381 @@
+// cl-bench: throughput / latency / contention benchmark for the logger
+//
+// build:   cc -O2 -o cl-bench tools/cl_bench.c logger.c -lpthread
+// usage:   cl-bench [-t threads] [-n messages_per_thread] [-o results.json]
+//
+// Runs [threads] producers against every configuration:
+//  single file / separate file for every thread  x  set_buffer_Level(0 ... 4)  x  console on / off  x  short / long messages
+// Every configuration runs in its own process and working directory (the logger has global state and owns ./logs).
+//
+// Reported per configuration:
+//  msg/s               messages per second, wall time from the first call until log_shutdown() returned
+//  p50 / p99 / p999 / max   latency of a single CL_LOG call in ns
+//  bytes               bytes in the run directory after log_shutdown()
+//  sys/msg             syscalls per message, counted with the raw_syscalls:sys_enter tracepoint if perf allows it,
+//                      otherwise "n/a" (null with "syscalls_source":"unavailable" in the results)
+//
+// The results are written as one JSON object per line (stable key order) so runs can be diffed.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "../logger.h"
+
+typedef struct bench_config {
+    int separate_files;
+    int buffer_level;
+    int console;
+    int long_messages;
+} bench_config;
+
+typedef struct bench_result {
+    uint64_t messages;
+    double messages_per_second;
+    uint64_t latency_p50_ns;
+    uint64_t latency_p99_ns;
+    uint64_t latency_p999_ns;
+    uint64_t latency_max_ns;
+    uint64_t bytes_written;
+    double syscalls_per_message;
+    int syscalls_from_tracepoint;
+    int valid;
+} bench_result;
+
+typedef struct producer_args {
+    int messages;
+    int long_messages;
+    uint64_t* latencies;
+    pthread_barrier_t* start;
+} producer_args;
+
+static const char* long_text =
+    "long message payload: Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore "
+    "magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat. Duis aute "
+    "irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla pariatur. Excepteur sint occaecat cupidatat non "
+    "proident, sunt in culpa qui officia deserunt mollit anim id est laborum. Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed "
+    "do eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi";
+
+// ------------------------------------------------------------------------------------------ Helpers ------------------------------------------------------------------------------------------
+
+static uint64_t now_ns() {
+
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (uint64_t)spec.tv_sec * 1000000000ull + (uint64_t)spec.tv_nsec;
+}
+
+static int compare_u64(const void* a, const void* b) {
+
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// counts all syscalls of this process and its threads created afterwards, returns -1 if not permitted
+static int open_Syscall_Counter() {
+
+    const char* paths[] = { "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id", "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id" };
+    for (size_t x = 0; x < sizeof(paths) / sizeof(paths[0]); x++) {
+
+        FILE* file = fopen(paths[x], "r");
+        if (file == NULL)
+            continue;
+
+        unsigned long long id = 0;
+        int found = fscanf(file, "%llu", &id);
+        fclose(file);
+        if (found != 1)
+            continue;
+
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_TRACEPOINT;
+        attr.size = sizeof(attr);
+        attr.config = id;
+        attr.inherit = 1;
+        attr.disabled = 1;
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd >= 0)
+            return fd;
+    }
+    return -1;
+}
+
+static uint64_t directory_Bytes(const char* path) {
+
+    DIR* dir = opendir(path);
+    if (dir == NULL)
+        return 0;
+
+    uint64_t total = 0;
+    struct dirent* entry;
+    char filepath[1024];
+    while ((entry = readdir(dir)) != NULL) {
+
+        struct stat st;
+        snprintf(filepath, sizeof(filepath), "%s/%s", path, entry->d_name);
+        if (entry->d_name[0] != '.' && stat(filepath, &st) == 0 && S_ISREG(st.st_mode))
+            total += (uint64_t)st.st_size;
+    }
+    closedir(dir);
+    return total;
+}
+
+static void remove_Directory(const char* path) {
+
+    DIR* dir = opendir(path);
+    if (dir == NULL)
+        return;
+
+    struct dirent* entry;
+    char filepath[1024];
+    while ((entry = readdir(dir)) != NULL) {
+
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        struct stat st;
+        snprintf(filepath, sizeof(filepath), "%s/%s", path, entry->d_name);
+        if (lstat(filepath, &st) == 0 && S_ISDIR(st.st_mode))
+            remove_Directory(filepath);
+        else
+            unlink(filepath);
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+// ------------------------------------------------------------------------------------------ Benchmark ------------------------------------------------------------------------------------------
+
+static void* producer(void* arg) {
+
+    producer_args* args = arg;
+    pthread_barrier_wait(args->start);
+
+    for (int x = 0; x < args->messages; x++) {
+
+        uint64_t start = now_ns();
+        if (args->long_messages)
+            CL_LOG(Info, "%s %d", long_text, x)
+        else
+            CL_LOG(Info, "short message %d", x)
+        args->latencies[x] = now_ns() - start;
+    }
+    return NULL;
+}
+
+// runs in a child process inside its own working directory
+static bench_result run_Config(const bench_config* config, int threads, int messages) {
+
+    bench_result result;
+    memset(&result, 0, sizeof(result));
+
+    // console output goes to /dev/null, the cost of printing is still measured
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+
+    log_init("bench", "[$N $T] $L [$F:$G] $C$Z", pthread_self(), config->separate_files);
+    set_buffer_Level(config->buffer_level);
+    set_log_level(config->console ? Trace : Error);
+
+    uint64_t* latencies = calloc((size_t)threads * (size_t)messages, sizeof(uint64_t));
+    pthread_t* thread_ids = calloc((size_t)threads, sizeof(pthread_t));
+    producer_args* args = calloc((size_t)threads, sizeof(producer_args));
+    if (latencies == NULL || thread_ids == NULL || args == NULL)
+        return result;
+
+    int counter_fd = open_Syscall_Counter();
+    result.syscalls_from_tracepoint = counter_fd >= 0;
+
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, (unsigned)threads + 1);
+    for (int x = 0; x < threads; x++) {
+
+        args[x].messages = messages;
+        args[x].long_messages = config->long_messages;
+        args[x].latencies = &latencies[(size_t)x * (size_t)messages];
+        args[x].start = &start;
+        pthread_create(&thread_ids[x], NULL, producer, &args[x]);
+    }
+
+    if (counter_fd >= 0) {
+        ioctl(counter_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    uint64_t begin = now_ns();
+    pthread_barrier_wait(&start);
+    for (int x = 0; x < threads; x++)
+        pthread_join(thread_ids[x], NULL);
+    log_shutdown();
+    uint64_t elapsed = now_ns() - begin;
+
+    uint64_t syscalls = 0;
+    if (counter_fd >= 0) {
+
+        ioctl(counter_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counter_fd, &syscalls, sizeof(syscalls)) != sizeof(syscalls))
+            syscalls = 0;
+        close(counter_fd);
+    }
+
+    size_t count = (size_t)threads * (size_t)messages;
+    qsort(latencies, count, sizeof(uint64_t), compare_u64);
+
+    result.messages = count;
+    result.messages_per_second = (double)count / ((double)elapsed / 1e9);
+    result.latency_p50_ns = latencies[count / 2];
+    result.latency_p99_ns = latencies[(size_t)((double)count * 0.99)];
+    result.latency_p999_ns = latencies[(size_t)((double)count * 0.999)];
+    result.latency_max_ns = latencies[count - 1];
+    result.bytes_written = directory_Bytes("./logs/latest");
+    result.syscalls_per_message = (double)syscalls / (double)count;
+    result.valid = 1;
+
+    free(latencies);
+    free(thread_ids);
+    free(args);
+    return result;
+}
+
+// fork a child for [config] and collect its result through a pipe
+static bench_result run_Isolated(const bench_config* config, int threads, int messages, const char* workdir) {
+
+    bench_result result;
+    memset(&result, 0, sizeof(result));
+
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0)
+        return result;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+
+        close(pipe_fds[0]);
+        if (mkdir(workdir, 0777) != 0 || chdir(workdir) != 0)
+            _exit(1);
+
+        bench_result child_result = run_Config(config, threads, messages);
+        ssize_t written = write(pipe_fds[1], &child_result, sizeof(child_result));
+        _exit(written == sizeof(child_result) ? 0 : 1);
+    }
+
+    close(pipe_fds[1]);
+    if (pid > 0) {
+
+        if (read(pipe_fds[0], &result, sizeof(result)) != sizeof(result))
+            result.valid = 0;
+        waitpid(pid, NULL, 0);
+    }
+    close(pipe_fds[0]);
+    remove_Directory(workdir);
+    return result;
+}
+
+// ------------------------------------------------------------------------------------------ Main ------------------------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+
+    int threads = 4;
+    int messages = 20000;
+    const char* output_name = "cl_bench_results.json";
+
+    int option;
+    while ((option = getopt(argc, argv, "t:n:o:")) != -1) {
+
+        switch (option) {
+        case 't': threads = atoi(optarg); break;
+        case 'n': messages = atoi(optarg); break;
+        case 'o': output_name = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-t threads] [-n messages_per_thread] [-o results.json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (threads <= 0 || messages <= 0) {
+        fprintf(stderr, "threads and messages must be positive\n");
+        return 2;
+    }
+
+    FILE* output = fopen(output_name, "w");
+    if (output == NULL) {
+        perror(output_name);
+        return 1;
+    }
+
+    char base_dir[] = "/tmp/cl_bench_XXXXXX";
+    if (mkdtemp(base_dir) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    printf("threads: %d  messages per thread: %d\n\n", threads, messages);
+    printf("%-8s %-3s %-4s %-5s | %12s %9s %9s %9s %10s %12s %8s\n", "files", "buf", "cons", "msg", "msg/s", "p50 ns", "p99 ns", "p999 ns", "max ns", "bytes", "sys/msg");
+
+    int failed = 0;
+    bool syscalls_unavailable = false;
+    for (int separate_files = 0; separate_files <= 1; separate_files++)
+    for (int buffer_level = 0; buffer_level <= 4; buffer_level++)
+    for (int console = 0; console <= 1; console++)
+    for (int long_messages = 0; long_messages <= 1; long_messages++) {
+
+        bench_config config = { separate_files, buffer_level, console, long_messages };
+        char workdir[sizeof(base_dir) + 64];
+        snprintf(workdir, sizeof(workdir), "%s/run_%d_%d_%d_%d", base_dir, separate_files, buffer_level, console, long_messages);
+
+        bench_result result = run_Isolated(&config, threads, messages, workdir);
+        if (!result.valid) {
+
+            printf("%-8s %-3d %-4s %-5s | FAILED\n", separate_files ? "thread" : "single", buffer_level, console ? "on" : "off", long_messages ? "long" : "short");
+            failed++;
+            continue;
+        }
+
+        // without the tracepoint there is no number that covers io_uring_enter(), sendmsg(), ... so none is reported
+        char syscalls_text[32] = "n/a";
+        char syscalls_json[32] = "null";
+        if (result.syscalls_from_tracepoint) {
+
+            snprintf(syscalls_text, sizeof(syscalls_text), "%.2f", result.syscalls_per_message);
+            snprintf(syscalls_json, sizeof(syscalls_json), "%.3f", result.syscalls_per_message);
+        }
+
+        printf("%-8s %-3d %-4s %-5s | %12.0f %9" PRIu64 " %9" PRIu64 " %9" PRIu64 " %10" PRIu64 " %12" PRIu64 " %8s\n",
+            separate_files ? "thread" : "single", buffer_level, console ? "on" : "off", long_messages ? "long" : "short",
+            result.messages_per_second, result.latency_p50_ns, result.latency_p99_ns, result.latency_p999_ns, result.latency_max_ns,
+            result.bytes_written, syscalls_text);
+
+        fprintf(output, "{\"files\":\"%s\",\"buffer_level\":%d,\"console\":%s,\"message\":\"%s\",\"threads\":%d,\"messages\":%" PRIu64 ","
+            "\"messages_per_second\":%.1f,\"latency_p50_ns\":%" PRIu64 ",\"latency_p99_ns\":%" PRIu64 ",\"latency_p999_ns\":%" PRIu64 ","
+            "\"latency_max_ns\":%" PRIu64 ",\"bytes_written\":%" PRIu64 ",\"syscalls_per_message\":%s,\"syscalls_source\":\"%s\"}\n",
+            separate_files ? "thread" : "single", buffer_level, console ? "true" : "false", long_messages ? "long" : "short", threads, result.messages,
+            result.messages_per_second, result.latency_p50_ns, result.latency_p99_ns, result.latency_p999_ns,
+            result.latency_max_ns, result.bytes_written, syscalls_json, result.syscalls_from_tracepoint ? "tracepoint" : "unavailable");
+        fflush(output);
+        syscalls_unavailable |= !result.syscalls_from_tracepoint;
+    }
+
+    if (syscalls_unavailable)
+        printf("\nsys/msg: the raw_syscalls:sys_enter tracepoint is not available (perf_event_paranoid / tracefs permissions)\n");
+    printf("results written to [%s]\n", output_name);
+    fclose(output);
+    rmdir(base_dir);
+    return failed ? 1 : 0;
+}
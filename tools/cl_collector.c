@@ -0,0 +1,64 @@
+// cl-collector: owns the log files for all processes that log through a shared-memory ring
+//
+// build:   cc -O2 -o cl-collector tools/cl_collector.c logger.c -lpthread
+// usage:   cl-collector [-n shm_name] [-f log_file_name] [-s]
+//  -n  name of the shared-memory ring (default: "/cl_log")
+//  -f  name of the main log file in the run directory (default: "collector")
+//  -s  use separate files for every producer thread
+//
+// Producers attach with: log_init_shared_producer("/cl_log", "[$T] $L $C$Z");
+// Runs until SIGINT / SIGTERM, then drains the ring and flushes all files.
+
+#include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdbool.h>
+
+#include "../logger.h"
+
+static volatile sig_atomic_t keep_running = 1;
+
+static void on_Signal(int signal_number) {
+
+    (void)signal_number;
+    keep_running = 0;
+}
+
+int main(int argc, char** argv) {
+
+    const char* shm_name = "/cl_log";
+    char* log_file_name = "collector";
+    int separate_files = 0;
+
+    int option;
+    while ((option = getopt(argc, argv, "n:f:s")) != -1) {
+
+        switch (option) {
+        case 'n': shm_name = optarg; break;
+        case 'f': log_file_name = optarg; break;
+        case 's': separate_files = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-n shm_name] [-f log_file_name] [-s]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    struct sigaction action = { .sa_handler = on_Signal };
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    log_init(log_file_name, "[$N $T] $L $C$Z", pthread_self(), separate_files);
+    set_log_level(Warn);
+    if (log_start_shared_collector(shm_name) != 0) {
+
+        fprintf(stderr, "Failed to attach to shared memory [%s]\n", shm_name);
+        log_shutdown();
+        return 1;
+    }
+
+    while (keep_running)
+        pause();
+
+    log_shutdown();
+    return 0;
+}
@@ -0,0 +1,234 @@
+// cl-merge: merges per-thread log files (written with [Use_separate_Files_for_every_Thread]) into one ordered stream
+//
+// build:   cc -O2 -o cl-merge tools/cl_merge.c
+// usage:   cl-merge [-k] [-t] [-o output] file...
+//  -k  keep the record stamps in the output
+//  -t  order by timestamp instead of sequence number (e.g. for files of different processes)
+//  -o  write to [output] instead of stdout
+//
+// Every input is memory-mapped and read sequentially, the merge itself is a k-way merge over a binary heap.
+// Lines in front of the first record of a file (the header written by Create_Log_File) are skipped.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../logger.h"
+
+typedef struct merge_input {
+    const char* name;
+    const char* data;
+    size_t size;
+    size_t record_start;
+    size_t record_end;
+    uint64_t sequence;
+    uint64_t time_ns;
+} merge_input;
+
+static bool order_by_time = false;
+
+// ------------------------------------------------------------------------------------------ Parsing ------------------------------------------------------------------------------------------
+
+// check if [line] starts with a valid record stamp and extract its values
+static bool parse_Stamp(const char* line, size_t remaining, uint64_t* sequence, uint64_t* time_ns) {
+
+    if (remaining < CL_RECORD_STAMP_LEN || line[0] != CL_RECORD_STAMP_MARKER || line[17] != ' ' || line[37] != ' '
+        || line[38] < '0' || line[38] > '9' || line[39] != ' ')
+        return false;
+
+    uint64_t loc_sequence = 0;
+    for (int x = 1; x < 17; x++) {
+
+        char c = line[x];
+        if (c >= '0' && c <= '9')           loc_sequence = (loc_sequence << 4) | (uint64_t)(c - '0');
+        else if (c >= 'a' && c <= 'f')      loc_sequence = (loc_sequence << 4) | (uint64_t)(c - 'a' + 10);
+        else                                return false;
+    }
+
+    uint64_t loc_time = 0;
+    for (int x = 18; x < 37; x++) {
+
+        char c = line[x];
+        if (c < '0' || c > '9')
+            return false;
+        loc_time = loc_time * 10 + (uint64_t)(c - '0');
+    }
+
+    *sequence = loc_sequence;
+    *time_ns = loc_time;
+    return true;
+}
+
+// returns the offset of the line following the line starting at [pos]
+static size_t next_Line(const merge_input* input, size_t pos) {
+
+    const char* newline = memchr(input->data + pos, '\n', input->size - pos);
+    return (newline == NULL) ? input->size : (size_t)(newline - input->data) + 1;
+}
+
+// find the next record starting at or after line-start [pos], returns false if the input is exhausted
+static bool find_Record(merge_input* input, size_t pos) {
+
+    while (pos < input->size && !parse_Stamp(input->data + pos, input->size - pos, &input->sequence, &input->time_ns))
+        pos = next_Line(input, pos);
+
+    if (pos >= input->size)
+        return false;
+
+    // a record reaches until the next stamped line (messages can contain line breaks)
+    input->record_start = pos;
+    size_t end = next_Line(input, pos);
+    uint64_t dummy_sequence, dummy_time;
+    while (end < input->size && !parse_Stamp(input->data + end, input->size - end, &dummy_sequence, &dummy_time))
+        end = next_Line(input, end);
+
+    input->record_end = end;
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------ Heap ------------------------------------------------------------------------------------------
+
+static bool is_Before(const merge_input* a, const merge_input* b) {
+
+    if (order_by_time && a->time_ns != b->time_ns)
+        return a->time_ns < b->time_ns;
+
+    if (a->sequence != b->sequence)
+        return a->sequence < b->sequence;
+
+    return a->time_ns < b->time_ns;
+}
+
+static void sift_Down(merge_input** heap, size_t count, size_t index) {
+
+    while (true) {
+
+        size_t smallest = index;
+        size_t left = 2 * index + 1;
+        size_t right = left + 1;
+        if (left < count && is_Before(heap[left], heap[smallest]))
+            smallest = left;
+        if (right < count && is_Before(heap[right], heap[smallest]))
+            smallest = right;
+        if (smallest == index)
+            return;
+
+        merge_input* tmp = heap[index];
+        heap[index] = heap[smallest];
+        heap[smallest] = tmp;
+        index = smallest;
+    }
+}
+
+// ------------------------------------------------------------------------------------------ Main ------------------------------------------------------------------------------------------
+
+static bool map_Input(merge_input* input, const char* name) {
+
+    memset(input, 0, sizeof(merge_input));
+    input->name = name;
+
+    int fd = open(name, O_RDONLY);
+    if (fd < 0) {
+        perror(name);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror(name);
+        return false;
+    }
+
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    input->data = data;
+    input->size = (size_t)st.st_size;
+    return true;
+}
+
+int main(int argc, char** argv) {
+
+    bool keep_stamps = false;
+    const char* output_name = NULL;
+
+    int option;
+    while ((option = getopt(argc, argv, "kto:")) != -1) {
+
+        switch (option) {
+        case 'k': keep_stamps = true; break;
+        case 't': order_by_time = true; break;
+        case 'o': output_name = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-k] [-t] [-o output] file...\n", argv[0]);
+            return 2;
+        }
+    }
+
+    size_t input_count = (size_t)(argc - optind);
+    if (input_count == 0) {
+        fprintf(stderr, "usage: %s [-k] [-t] [-o output] file...\n", argv[0]);
+        return 2;
+    }
+
+    FILE* out = stdout;
+    if (output_name != NULL) {
+
+        out = fopen(output_name, "w");
+        if (out == NULL) {
+            perror(output_name);
+            return 1;
+        }
+    }
+    setvbuf(out, NULL, _IOFBF, 1 << 20);
+
+    merge_input* inputs = calloc(input_count, sizeof(merge_input));
+    merge_input** heap = calloc(input_count, sizeof(merge_input*));
+    if (inputs == NULL || heap == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+
+    size_t heap_count = 0;
+    for (size_t x = 0; x < input_count; x++) {
+
+        if (map_Input(&inputs[x], argv[optind + x]) && find_Record(&inputs[x], 0))
+            heap[heap_count++] = &inputs[x];
+    }
+
+    for (size_t x = heap_count; x-- > 0;)
+        sift_Down(heap, heap_count, x);
+
+    while (heap_count > 0) {
+
+        merge_input* top = heap[0];
+        size_t start = top->record_start + (keep_stamps ? 0 : CL_RECORD_STAMP_LEN);
+        fwrite(top->data + start, 1, top->record_end - start, out);
+
+        if (!find_Record(top, top->record_end))
+            heap[0] = heap[--heap_count];
+        sift_Down(heap, heap_count, 0);
+    }
+
+    for (size_t x = 0; x < input_count; x++)
+        if (inputs[x].data != NULL)
+            munmap((void*)inputs[x].data, inputs[x].size);
+
+    free(heap);
+    free(inputs);
+    if (out != stdout)
+        fclose(out);
+    else
+        fflush(out);
+    return 0;
+}
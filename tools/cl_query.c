@@ -0,0 +1,361 @@
+// cl-query: answers time-range / level / substring queries on log files using the sidecar index [<log file>.idx]
+//
+// build:   cc -O2 -o cl-query tools/cl_query.c
+// usage:   cl-query [-f from] [-u until] [-l levels] [-s substring] [-k] file...
+//  -f / -u     time range, "hh:mm[:ss]" (today), "yyyy-mm-dd hh:mm[:ss]" or "@<nanoseconds since epoch>",
+//              -u includes the whole minute (or second) it names
+//  -l          comma separated log levels, e.g. "Error,Fatal"
+//  -s          only records containing [substring]
+//  -k          keep the record stamps in the output
+//
+// Only the blocks of the index that overlap the time range and contain one of the requested levels are read,
+// plus every part of the file no block covers (written while the index was disabled or not indexed yet).
+// Inside a block every record carries a stamp with its exact time and level (see CL_RECORD_STAMP_FORMAT).
+// Records without a stamp (written while the index was disabled) are split by line and can not be filtered
+// by time or level. Files without an index are scanned completely.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../logger.h"
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+typedef struct mapped_file {
+    const char* data;
+    size_t size;
+} mapped_file;
+
+typedef struct query {
+    uint64_t from_ns;
+    uint64_t until_ns;
+    uint32_t level_mask;
+    const char* substring;
+    size_t substring_len;
+    bool keep_stamps;
+} query;
+
+static const char* level_str[LL_MAX_NUM] = {"FATAL", "ERROR", "WARN", "INFO", "DEBUG", "TRACE"};
+static const uint32_t all_levels = (1u << LL_MAX_NUM) - 1;
+
+// ------------------------------------------------------------------------------------------ Helpers ------------------------------------------------------------------------------------------
+
+static bool map_File(mapped_file* file, const char* name, bool report_error) {
+
+    file->data = NULL;
+    file->size = 0;
+
+    int fd = open(name, O_RDONLY);
+    if (fd < 0) {
+        if (report_error)
+            perror(name);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror(name);
+        return false;
+    }
+
+    file->data = data;
+    file->size = (size_t)st.st_size;
+    return true;
+}
+
+// parse "hh:mm[:ss]", "yyyy-mm-dd hh:mm[:ss]" (local time) or "@<ns>"
+// an [upper_bound] covers the whole minute (or second) it names, e.g. "14:05" is 14:05:59.999999999
+static bool parse_Time(const char* text, uint64_t* time_ns, bool upper_bound) {
+
+    if (text[0] == '@') {
+        *time_ns = strtoull(text + 1, NULL, 10);
+        return true;
+    }
+
+    time_t now = time(NULL);
+    struct tm tm = *localtime(&now);
+    tm.tm_sec = 0;
+    int year, month, day, hour, min, sec = 0;
+    int fields = sscanf(text, "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour, &min, &sec);
+    bool has_seconds = fields == 6;
+    if (fields >= 5) {
+
+        tm.tm_year = year - 1900;
+        tm.tm_mon = month - 1;
+        tm.tm_mday = day;
+    }
+    else {
+
+        fields = sscanf(text, "%d:%d:%d", &hour, &min, &sec);
+        if (fields < 2)
+            return false;
+        has_seconds = fields == 3;
+    }
+
+    tm.tm_hour = hour;
+    tm.tm_min = min;
+    tm.tm_sec = sec;
+    tm.tm_isdst = -1;
+    time_t result = mktime(&tm);
+    if (result == (time_t)-1)
+        return false;
+
+    *time_ns = (uint64_t)result * 1000000000ull;
+    if (upper_bound)
+        *time_ns += (has_seconds ? 1 : 60) * 1000000000ull - 1;
+    return true;
+}
+
+static bool parse_Levels(char* text, uint32_t* level_mask) {
+
+    *level_mask = 0;
+    for (char* token = strtok(text, ","); token != NULL; token = strtok(NULL, ",")) {
+
+        bool found = false;
+        for (int x = 0; x < LL_MAX_NUM; x++) {
+
+            if (strcasecmp(token, level_str[x]) == 0) {
+                *level_mask |= 1u << x;
+                found = true;
+            }
+        }
+        if (!found)
+            return false;
+    }
+    return true;
+}
+
+// reads time and level of a record stamp, returns false if [line] has none
+static bool parse_Stamp(const char* line, size_t remaining, uint64_t* time_ns, int* level) {
+
+    if (remaining < CL_RECORD_STAMP_LEN || line[0] != CL_RECORD_STAMP_MARKER || line[17] != ' ' || line[37] != ' '
+        || line[38] < '0' || line[38] >= '0' + LL_MAX_NUM || line[39] != ' ')
+        return false;
+
+    uint64_t loc_time = 0;
+    for (int x = 18; x < 37; x++) {
+
+        if (line[x] < '0' || line[x] > '9')
+            return false;
+        loc_time = loc_time * 10 + (uint64_t)(line[x] - '0');
+    }
+
+    *time_ns = loc_time;
+    *level = line[38] - '0';
+    return true;
+}
+
+// returns the offset behind the title section written by Create_Log_File (ends with a line of '='), 0 if there is none
+static size_t skip_Title_Section(const char* data, size_t size) {
+
+    const char* newline = memchr(data, '\n', size);
+    if (data[0] != '[' || newline == NULL || memmem(data, (size_t)(newline - data), "] Log initialized", 17) == NULL)
+        return 0;
+
+    const char* pos = newline + 1;
+    const char* end = data + size;
+    while (pos < end) {
+
+        newline = memchr(pos, '\n', (size_t)(end - pos));
+        const char* line_end = (newline == NULL) ? end : newline + 1;
+        if (pos[0] == '=') {
+
+            // the separator is followed by an empty line
+            if (line_end < end && line_end[0] == '\n')
+                line_end++;
+            return (size_t)(line_end - data);
+        }
+        pos = line_end;
+    }
+    return 0;
+}
+
+// ------------------------------------------------------------------------------------------ Scanning ------------------------------------------------------------------------------------------
+
+static bool record_Matches(const query* q, const char* record, size_t length) {
+
+    return q->substring_len == 0 || memmem(record, length, q->substring, q->substring_len) != NULL;
+}
+
+// scan one block of the log file, [first_ns]/[last_ns] and [block_mask] describe the block (used for records without stamp)
+// returns the number of records without stamp that could only be filtered by their block
+static size_t scan_Block(const query* q, FILE* out, const char* data, size_t length, uint64_t first_ns, uint64_t last_ns, uint32_t block_mask) {
+
+    size_t unstamped = 0;
+    const char* end = data + length;
+    const char* pos = data;
+    while (pos < end) {
+
+        // a record is everything up to the next stamp, or a single line if it has no stamp
+        uint64_t record_time = 0;
+        int record_level = 0;
+        bool stamped = parse_Stamp(pos, (size_t)(end - pos), &record_time, &record_level);
+        const char* newline = memchr(pos, '\n', (size_t)(end - pos));
+        const char* record_end = (newline == NULL) ? end : newline + 1;
+        if (stamped) {
+
+            uint64_t dummy_time;
+            int dummy_level;
+            while (record_end < end && !parse_Stamp(record_end, (size_t)(end - record_end), &dummy_time, &dummy_level)) {
+
+                newline = memchr(record_end, '\n', (size_t)(end - record_end));
+                record_end = (newline == NULL) ? end : newline + 1;
+            }
+        }
+
+        bool selected;
+        if (stamped)
+            selected = record_time >= q->from_ns && record_time <= q->until_ns && (q->level_mask & (1u << record_level)) != 0;
+        else {
+
+            selected = last_ns >= q->from_ns && first_ns <= q->until_ns && (block_mask & q->level_mask) != 0;
+            unstamped++;
+        }
+
+        if (selected && record_Matches(q, pos, (size_t)(record_end - pos))) {
+
+            const char* start = (stamped && !q->keep_stamps) ? pos + CL_RECORD_STAMP_LEN : pos;
+            fwrite(start, 1, (size_t)(record_end - start), out);
+        }
+
+        pos = record_end;
+    }
+    return unstamped;
+}
+
+static void query_File(const query* q, FILE* out, const char* name) {
+
+    mapped_file log;
+    if (!map_File(&log, name, true))
+        return;
+
+    char index_name[4096];
+    snprintf(index_name, sizeof(index_name), "%s.idx", name);
+    mapped_file index;
+    if (!map_File(&index, index_name, false) || index.size < CL_INDEX_MAGIC_LEN || memcmp(index.data, CL_INDEX_MAGIC, CL_INDEX_MAGIC_LEN) != 0) {
+
+        fprintf(stderr, "%s: no usable index, scanning the whole file\n", name);
+        madvise((void*)log.data, log.size, MADV_SEQUENTIAL);
+        size_t start = skip_Title_Section(log.data, log.size);
+        size_t unstamped = scan_Block(q, out, log.data + start, log.size - start, 0, UINT64_MAX, all_levels);
+        if (unstamped > 0 && (q->from_ns != 0 || q->until_ns != UINT64_MAX || q->level_mask != all_levels))
+            fprintf(stderr, "%s: %zu records without stamp, they can not be filtered by time or level\n", name, unstamped);
+        munmap((void*)log.data, log.size);
+        if (index.data != NULL)
+            munmap((void*)index.data, index.size);
+        return;
+    }
+
+    // entries are written in file order, everything between them (written while the index was disabled, the title
+    // section aside) and behind the last one (the open block of a running or crashed process) is scanned completely
+    size_t entry_count = (index.size - CL_INDEX_MAGIC_LEN) / sizeof(cl_index_entry);
+    const cl_index_entry* entries = (const cl_index_entry*)(index.data + CL_INDEX_MAGIC_LEN);
+    uint64_t covered_end = skip_Title_Section(log.data, log.size);
+    size_t unstamped = 0;
+    for (size_t x = 0; x < entry_count; x++) {
+
+        const cl_index_entry* entry = &entries[x];
+        if (entry->offset >= log.size)
+            continue;
+
+        if (entry->offset > covered_end)
+            unstamped += scan_Block(q, out, log.data + covered_end, (size_t)(entry->offset - covered_end), 0, UINT64_MAX, all_levels);
+        covered_end = MAX(covered_end, MIN(entry->offset + entry->length, (uint64_t)log.size));
+
+        if (entry->time_last_ns < q->from_ns || entry->time_first_ns > q->until_ns || (entry->level_mask & q->level_mask) == 0)
+            continue;
+
+        size_t length = (size_t)MIN(entry->length, (uint64_t)(log.size - entry->offset));
+        unstamped += scan_Block(q, out, log.data + entry->offset, length, entry->time_first_ns, entry->time_last_ns, entry->level_mask);
+    }
+
+    if (covered_end < log.size)
+        unstamped += scan_Block(q, out, log.data + covered_end, log.size - (size_t)covered_end, 0, UINT64_MAX, all_levels);
+
+    if (unstamped > 0 && (q->from_ns != 0 || q->until_ns != UINT64_MAX || q->level_mask != all_levels))
+        fprintf(stderr, "%s: %zu records without stamp, they can not be filtered by time or level\n", name, unstamped);
+
+    munmap((void*)index.data, index.size);
+    munmap((void*)log.data, log.size);
+}
+
+// ------------------------------------------------------------------------------------------ Main ------------------------------------------------------------------------------------------
+
+static void print_Usage(const char* program) {
+
+    fprintf(stderr, "usage: %s [-f from] [-u until] [-l levels] [-s substring] [-k] file...\n", program);
+}
+
+int main(int argc, char** argv) {
+
+    query q = { .from_ns = 0, .until_ns = UINT64_MAX, .level_mask = all_levels, .substring = NULL, .substring_len = 0, .keep_stamps = false };
+
+    int option;
+    while ((option = getopt(argc, argv, "f:u:l:s:k")) != -1) {
+
+        switch (option) {
+        case 'f':
+            if (!parse_Time(optarg, &q.from_ns, false)) {
+                fprintf(stderr, "invalid time: %s\n", optarg);
+                return 2;
+            }
+            break;
+
+        case 'u':
+            if (!parse_Time(optarg, &q.until_ns, true)) {
+                fprintf(stderr, "invalid time: %s\n", optarg);
+                return 2;
+            }
+            break;
+
+        case 'l':
+            if (!parse_Levels(optarg, &q.level_mask)) {
+                fprintf(stderr, "invalid log level list: %s\n", optarg);
+                return 2;
+            }
+            break;
+
+        case 's':
+            q.substring = optarg;
+            q.substring_len = strlen(optarg);
+            break;
+
+        case 'k':
+            q.keep_stamps = true;
+            break;
+
+        default:
+            print_Usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (optind >= argc) {
+        print_Usage(argv[0]);
+        return 2;
+    }
+
+    setvbuf(stdout, NULL, _IOFBF, 1 << 20);
+    for (int x = optind; x < argc; x++)
+        query_File(&q, stdout, argv[x]);
+
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,195 @@
+// cl-receiver: minimal receiver for the socket sink (log_connect_socket_sink), prints every record to stdout
+//
+// build:   cc -O2 -o cl-receiver tools/cl_receiver.c
+// usage:   cl-receiver [-d] [-v] socket_path
+//  -d  datagram socket (default: stream socket, any number of producers)
+//  -v  print pid, thread and sequence number in front of every record
+//
+// Runs until SIGINT / SIGTERM.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "../logger.h"
+
+#define MAX_CLIENTS             256
+#define RECEIVE_BUFFER_SIZE     (64 * 1024)
+
+typedef struct client {
+    int fd;
+    size_t used;
+    char buffer[RECEIVE_BUFFER_SIZE];
+} client;
+
+static volatile sig_atomic_t keep_running = 1;
+static bool verbose = false;
+
+static void on_Signal(int signal_number) {
+
+    (void)signal_number;
+    keep_running = 0;
+}
+
+static void print_Record(const cl_socket_frame* frame, const char* text) {
+
+    if (verbose)
+        printf("[%d %" PRIx64 " #%" PRIu64 "] ", frame->pid, frame->thread, frame->sequence);
+    fwrite(text, 1, frame->length, stdout);
+}
+
+// print all complete records in the buffer of [c], returns false if the stream is corrupt
+static bool handle_Stream(client* c) {
+
+    size_t pos = 0;
+    while (c->used - pos >= sizeof(cl_socket_frame)) {
+
+        cl_socket_frame frame;
+        memcpy(&frame, c->buffer + pos, sizeof(frame));
+        if (frame.length > RECEIVE_BUFFER_SIZE - sizeof(frame))
+            return false;
+        if (c->used - pos < sizeof(frame) + frame.length)
+            break;
+
+        print_Record(&frame, c->buffer + pos + sizeof(frame));
+        pos += sizeof(frame) + frame.length;
+    }
+
+    memmove(c->buffer, c->buffer + pos, c->used - pos);
+    c->used -= pos;
+    return true;
+}
+
+static int open_Socket(const char* path, bool datagram) {
+
+    int fd = socket(AF_UNIX, datagram ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || (!datagram && listen(fd, 64) != 0)) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char** argv) {
+
+    bool datagram = false;
+    int option;
+    while ((option = getopt(argc, argv, "dv")) != -1) {
+
+        switch (option) {
+        case 'd': datagram = true; break;
+        case 'v': verbose = true; break;
+        default:
+            fprintf(stderr, "usage: %s [-d] [-v] socket_path\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-d] [-v] socket_path\n", argv[0]);
+        return 2;
+    }
+
+    const char* path = argv[optind];
+    struct sigaction action = { .sa_handler = on_Signal };
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    int listen_fd = open_Socket(path, datagram);
+    if (listen_fd < 0)
+        return 1;
+
+    static client clients[MAX_CLIENTS];
+    int client_count = 0;
+    struct pollfd fds[MAX_CLIENTS + 1];
+    while (keep_running) {
+
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        for (int x = 0; x < client_count; x++) {
+            fds[x + 1].fd = clients[x].fd;
+            fds[x + 1].events = POLLIN;
+        }
+
+        if (poll(fds, (nfds_t)client_count + 1, -1) < 0)
+            continue;
+
+        // clients accepted below were not part of this poll, their fds[] entries are stale
+        int polled_count = client_count;
+
+        if (fds[0].revents & POLLIN) {
+
+            if (datagram) {
+
+                char buffer[RECEIVE_BUFFER_SIZE];
+                ssize_t length = recv(listen_fd, buffer, sizeof(buffer), 0);
+                cl_socket_frame frame;
+                if (length >= (ssize_t)sizeof(frame)) {
+
+                    memcpy(&frame, buffer, sizeof(frame));
+                    if (sizeof(frame) + frame.length <= (size_t)length)
+                        print_Record(&frame, buffer + sizeof(frame));
+                }
+            }
+
+            else {
+
+                int fd = accept(listen_fd, NULL, NULL);
+                if (fd >= 0 && client_count < MAX_CLIENTS) {
+                    clients[client_count].fd = fd;
+                    clients[client_count].used = 0;
+                    client_count++;
+                }
+                else if (fd >= 0)
+                    close(fd);
+            }
+        }
+
+        for (int x = polled_count - 1; x >= 0; x--) {
+
+            if (!(fds[x + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+
+            // never block: one stuck producer must not stall all others
+            client* c = &clients[x];
+            ssize_t length = recv(c->fd, c->buffer + c->used, RECEIVE_BUFFER_SIZE - c->used, MSG_DONTWAIT);
+            if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+                continue;
+            if (length > 0) {
+
+                c->used += (size_t)length;
+                if (handle_Stream(c))
+                    continue;
+                fprintf(stderr, "corrupt stream, dropping connection\n");
+            }
+
+            close(c->fd);
+            clients[x] = clients[--client_count];
+        }
+        fflush(stdout);
+    }
+
+    for (int x = 0; x < client_count; x++)
+        close(clients[x].fd);
+    close(listen_fd);
+    unlink(path);
+    return 0;
+}